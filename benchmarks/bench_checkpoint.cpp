@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "../world/snapshot.hpp"
+
+// Simulation pause per checkpoint: a versioned snapshot against holding the
+// world for the whole save. Also what the next tick pays while the snapshot
+// is pinned, split into the allocation (taken before world_mutex) and the
+// locked writes plus publish, next to the same tick with nothing pinned.
+// Usage: bench_checkpoint [count...]
+
+namespace {
+using clock_type = std::chrono::steady_clock;
+
+double us_since(clock_type::time_point begin) {
+    return std::chrono::duration<double, std::micro>(clock_type::now() - begin).count();
+}
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i)
+        counts.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (counts.empty())
+        counts = {100000, 1000000, 10000000};
+
+    for (size_t count : counts) {
+        std::vector<NPCState> world;
+        factory(world, count, {{DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}},
+                4096, 4096, 42);
+        auto positions = positions_of(world);
+        // The part of a movement tick spent under world_mutex: every NPC
+        // written into the next version, then publish().
+        auto locked_tick_us = [&]() {
+            const auto begin = clock_type::now();
+            for (size_t i = 0; i < count; ++i) {
+                world[i].npc->x = (world[i].npc->x + 1) % 4096;
+                record_position(positions, i, world[i]);
+            }
+            positions.publish();
+            return us_since(begin);
+        };
+
+        positions.prepare();
+        const double plain_tick_us = locked_tick_us();
+
+        auto begin = clock_type::now();
+        const auto snapshot = positions.snapshot();
+        const double pause_us = us_since(begin);
+
+        // Ticks while the snapshot is held: the first reuses the spare
+        // buffer, the second finds its old front pinned and allocates.
+        positions.prepare();
+        const double pinned_tick_us = locked_tick_us();
+        begin = clock_type::now();
+        positions.prepare();
+        const double allocate_us = us_since(begin);
+        const double after_pinned_tick_us = locked_tick_us();
+
+        begin = clock_type::now();
+        {
+            std::ofstream out("/dev/null");
+            write_checkpoint(out, world, snapshot);
+        }
+        const double save_us = us_since(begin);
+
+        std::cout << count << " NPCs: snapshot pause " << pause_us << " us; locked tick "
+                  << plain_tick_us << " us unpinned, " << pinned_tick_us << " / "
+                  << after_pinned_tick_us << " us while pinned; allocation outside the lock "
+                  << allocate_us << " us (" << positions.allocations() << " buffers); "
+                  << "save (blocking pause without snapshots) " << save_us << " us"
+                  << std::endl;
+    }
+    return 0;
+}
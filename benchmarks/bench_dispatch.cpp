@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "../world/factory.hpp"
+#include "../world/npc_registry.hpp"
+
+// All-pairs "can attacker kill defender" over a population, four ways:
+// virtual accept/visit, the generated kill table, std::visit on NpcRef,
+// and per-type batches that only walk pairs the registry allows. Every way
+// does the same distance check on each allowed pair, so all four count the
+// same kills; ns/pair is the total time over all count * (count - 1) pairs.
+// Usage: bench_dispatch [npcs]
+
+namespace {
+template <typename F>
+void run(const char* name, size_t pairs, F f) {
+    const auto begin = std::chrono::steady_clock::now();
+    const size_t kills = f();
+    const double ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - begin).count();
+    std::cout << name << ": " << kills << " kills, " << ms << " ms, "
+              << ms * 1e6 / static_cast<double>(pairs) << " ns/pair" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 3000;
+
+    // No observers: only the dispatch and the distance check are measured.
+    std::vector<NPCState> world;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> type_dist(DragonType, KnightType);
+    std::uniform_int_distribution<int> coord(0, 499);
+    for (size_t i = 0; i < count; ++i)
+        world.push_back({make_npc(static_cast<NpcType>(type_dist(rng)), "n", coord(rng),
+                                  coord(rng)),
+                         true});
+    const size_t pairs = count * (count - 1);
+    auto in_reach = [&](size_t attacker, size_t prey) {
+        const auto& npc = world[attacker].npc;
+        return npc->is_close(world[prey].npc, get_attributes(npc->type).kill_distance);
+    };
+
+    run("virtual accept/visit", pairs, [&]() {
+        size_t kills = 0;
+        for (size_t i = 0; i < count; ++i)
+            for (size_t j = 0; j < count; ++j)
+                if (i != j && world[j].npc->accept(world[i].npc) && in_reach(i, j))
+                    ++kills;
+        return kills;
+    });
+
+    run("kill table", pairs, [&]() {
+        size_t kills = 0;
+        for (size_t i = 0; i < count; ++i)
+            for (size_t j = 0; j < count; ++j)
+                if (i != j && can_kill(world[i].npc->type, world[j].npc->type) &&
+                    in_reach(i, j))
+                    ++kills;
+        return kills;
+    });
+
+    std::vector<NpcRef> refs;
+    for (const auto& state : world)
+        refs.push_back(npc_ref(*state.npc));
+    run("std::visit", pairs, [&]() {
+        size_t kills = 0;
+        for (size_t i = 0; i < count; ++i)
+            for (size_t j = 0; j < count; ++j)
+                if (i != j && can_kill(refs[i], refs[j]) && in_reach(i, j))
+                    ++kills;
+        return kills;
+    });
+
+    run("type batches", pairs, [&]() {
+        TypeBatches batches;
+        batches.rebuild(world);
+        size_t kills = 0;
+        for_each_kill_pair([&](auto attacker_tag, auto prey_tag) {
+            using Attacker = typename decltype(attacker_tag)::type;
+            using Prey = typename decltype(prey_tag)::type;
+            for (const uint32_t a : batches.of<Attacker>())
+                for (const uint32_t p : batches.of<Prey>())
+                    if (a != p && world[a].npc->is_close(world[p].npc, Attacker::kKillDistance))
+                        ++kills;
+        });
+        return kills;
+    });
+    return 0;
+}
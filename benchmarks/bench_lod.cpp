@@ -0,0 +1,82 @@
+#include <array>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "../world/batch.hpp"
+#include "../world/simulation.hpp"
+
+// Full detail against adaptive level of detail (quiet regions updated every
+// 4th / 8th tick) on a sparse mixed world, a world with no possible fights
+// and the interactive run's dense 40x20 map. Prints batch throughput and the
+// mean survivors per type with their change against full detail, so any
+// drift in outcomes shows up.
+// Usage: bench_lod [runs]
+
+namespace {
+struct Scenario {
+    const char* name;
+    SimulationConfig config;
+};
+
+size_t total_kills(const BatchSummary& summary) {
+    size_t kills = 0;
+    for (const auto& histogram : summary.kill_ticks)
+        for (size_t count : histogram)
+            kills += count;
+    return kills;
+}
+}
+
+int main(int argc, char** argv) {
+    const size_t runs = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20;
+
+    std::vector<Scenario> scenarios(3);
+    scenarios[0].name = "sparse mixed 2000x2000, 1500 NPCs";
+    scenarios[0].config.width = 2000;
+    scenarios[0].config.height = 2000;
+    scenarios[0].config.npcs = 1500;
+    scenarios[1] = scenarios[0];
+    scenarios[1].name = "princesses and knights 2000x2000, 1500 NPCs";
+    scenarios[1].config.shares = {{PrincessType, 1.0}, {KnightType, 1.0}};
+    scenarios[2].name = "dense mixed 40x20, 50 NPCs";
+
+    WorkerPool pool;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& scenario : scenarios) {
+        std::cout << scenario.name << std::endl;
+        double full_rate = 0.0;
+        std::array<double, kNpcSlots> full_survivors{};
+        for (size_t interval : {1, 4, 8}) {
+            SimulationConfig config = scenario.config;
+            config.quiet_interval = interval;
+            const auto summary = run_batch(config, runs, 1, pool);
+            if (interval == 1)
+                full_rate = summary.runs_per_second();
+
+            Simulation probe(config, 1);
+            probe.run();
+            const double skipped = 100.0 * static_cast<double>(probe.skipped_moves()) /
+                                   static_cast<double>(config.npcs * config.ticks);
+
+            std::cout << "  quiet_interval " << interval << ": " << summary.runs_per_second()
+                      << " runs/s (x" << summary.runs_per_second() / full_rate << "), moves skipped "
+                      << skipped << "%, kills/run "
+                      << static_cast<double>(total_kills(summary)) / static_cast<double>(runs);
+            for_each_npc_type([&](auto tag) {
+                const NpcType type = decltype(tag)::type::kType;
+                const double survivors = summary.mean_survivors(type);
+                if (interval == 1)
+                    full_survivors[type] = survivors;
+                std::cout << ", " << type_label(type) << " " << survivors;
+                if (interval != 1 && full_survivors[type] > 0.0)
+                    std::cout << " (" << std::showpos
+                              << 100.0 * (survivors / full_survivors[type] - 1.0)
+                              << std::noshowpos << "%)";
+            });
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
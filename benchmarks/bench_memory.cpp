@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../world/compact_world.hpp"
+
+// Bytes per NPC for the object world and the compact world, both as counted
+// by the memory report and as seen by the OS (resident set growth). Every
+// measurement runs in a forked child, so memory freed by an earlier one
+// cannot be reused and hide the growth.
+// Usage: bench_memory [--compact-only] [count...]
+
+namespace {
+constexpr int kMapWidth = 40;
+constexpr int kMapHeight = 20;
+
+long long resident_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total = 0;
+    size_t resident = 0;
+    statm >> total >> resident;
+    return static_cast<long long>(resident) * sysconf(_SC_PAGESIZE);
+}
+
+double rss_per_npc(long long before, long long after, size_t count) {
+    return static_cast<double>(after - before) / static_cast<double>(count);
+}
+
+template <typename Fn>
+void in_child(Fn fn) {
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        std::cout.flush();
+        _exit(0);
+    }
+    if (pid < 0) {
+        std::cerr << "fork failed" << std::endl;
+        return;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+const std::vector<SpawnShare> kShares{
+    {DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}};
+
+void measure_objects(size_t count) {
+    const long long before = resident_bytes();
+    std::vector<NPCState> world;
+    factory(world, count, kShares, kMapWidth, kMapHeight, 42);
+    const long long after = resident_bytes();
+    const auto report = memory_report(world);
+    std::cout << count << " objects: report " << report.bytes_per_npc()
+              << " B/NPC, rss " << rss_per_npc(before, after, count) << " B/NPC" << std::endl;
+}
+
+void measure_compact(size_t count) {
+    const long long before = resident_bytes();
+    CompactWorld world;
+    compact_factory(world, count, kShares, kMapWidth, kMapHeight, 42);
+    const long long after = resident_bytes();
+    std::cout << count << " compact: report " << world.bytes_per_npc()
+              << " B/NPC, rss " << rss_per_npc(before, after, count) << " B/NPC" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+    bool compact_only = false;
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--compact-only")
+            compact_only = true;
+        else
+            counts.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (counts.empty())
+        counts = {1000000, 10000000, 50000000};
+
+    std::cout << "sizeof: NPC " << sizeof(NPC) << ", Dragon " << sizeof(Dragon)
+              << ", NPCState " << sizeof(NPCState) << std::endl;
+    for (size_t count : counts) {
+        if (!compact_only)
+            in_child([&]() { measure_objects(count); });
+        in_child([&]() { measure_compact(count); });
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../world/factory.hpp"
+
+// Time-to-first-tick for large populations: the old serial loop (named NPCs,
+// one push_back at a time) against the parallel bulk factory.
+// Usage: bench_startup [count...]
+
+namespace {
+constexpr int kMapWidth = 40;
+constexpr int kMapHeight = 20;
+
+double serial_spawn(size_t count) {
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<NPCState> world;
+    world.reserve(count);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> type_dist(1, 3);
+    std::uniform_int_distribution<int> x_dist(0, kMapWidth - 1);
+    std::uniform_int_distribution<int> y_dist(0, kMapHeight - 1);
+    for (size_t i = 0; i < count; ++i) {
+        NpcType type = static_cast<NpcType>(type_dist(rng));
+        std::string name = std::string(type_label(type)) + "_" + std::to_string(i);
+        auto npc = factory(type, name, x_dist(rng), y_dist(rng));
+        if (npc)
+            world.push_back({std::move(npc), true});
+    }
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - begin).count();
+}
+
+double bulk_spawn(size_t count) {
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<NPCState> world;
+    factory(world, count, {{DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}},
+            kMapWidth, kMapHeight, 42);
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - begin).count();
+}
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i)
+        counts.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (counts.empty())
+        counts = {100000, 1000000, 10000000};
+
+    std::cout << "threads: " << std::thread::hardware_concurrency() << std::endl;
+    for (size_t count : counts) {
+        const double serial = serial_spawn(count);
+        const double bulk = bulk_spawn(count);
+        std::cout << count << " NPCs: serial " << serial << " ms, bulk " << bulk
+                  << " ms (x" << serial / bulk << ")" << std::endl;
+    }
+    return 0;
+}
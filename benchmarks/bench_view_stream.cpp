@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../world/view_server.hpp"
+
+// Cost of one publish with many local viewers: grid rebuild plus per-viewer
+// deltas, against a naive full-world scan per viewer.
+// Usage: bench_view_stream [npcs] [viewers] [ticks]
+
+namespace {
+constexpr int kMapWidth = 4096;
+constexpr int kMapHeight = 4096;
+constexpr int kViewSize = 128;
+}
+
+int main(int argc, char** argv) {
+    const size_t npcs = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const int viewer_count = argc > 2 ? std::atoi(argv[2]) : 256;
+    const int ticks = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    std::vector<NPCState> world;
+    factory(world, npcs, {{DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}},
+            kMapWidth, kMapHeight, 42);
+
+    const std::string path = "/tmp/bench_view_" + std::to_string(::getpid()) + ".sock";
+    ViewServer server(kMapWidth, kMapHeight, 64);
+    if (!server.listen(path)) {
+        std::cerr << "Cannot listen on " << path << std::endl;
+        return 1;
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> origin(0, kMapWidth - kViewSize);
+    std::vector<std::unique_ptr<ViewClient>> clients;
+    std::vector<Viewport> viewports;
+    for (int c = 0; c < viewer_count; ++c) {
+        clients.push_back(std::make_unique<ViewClient>());
+        const int x0 = origin(rng);
+        const int y0 = origin(rng);
+        viewports.push_back({x0, y0, x0 + kViewSize - 1, y0 + kViewSize - 1});
+        if (!clients.back()->connect(path) || !clients.back()->request(viewports.back())) {
+            std::cerr << "Viewer " << c << " failed to connect" << std::endl;
+            return 1;
+        }
+    }
+
+    std::uniform_int_distribution<int> step(-2, 2);
+    double collect_ms = 0.0;
+    size_t records = 0;
+    for (int tick = 0; tick < ticks; ++tick) {
+        for (auto& state : world) {
+            state.npc->x = std::clamp(state.npc->x + step(rng), 0, kMapWidth - 1);
+            state.npc->y = std::clamp(state.npc->y + step(rng), 0, kMapHeight - 1);
+        }
+        server.poll_viewers();
+        const auto begin = std::chrono::steady_clock::now();
+        server.collect(static_cast<uint32_t>(tick), world);
+        collect_ms += std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - begin).count();
+        server.flush();
+        for (auto& client : clients) {
+            ViewFrameHeader header{};
+            std::vector<ViewDelta> deltas;
+            if (client->receive(header, deltas))
+                records += deltas.size();
+        }
+    }
+
+    // Naive alternative: every viewer scans the whole world once per tick.
+    const auto begin = std::chrono::steady_clock::now();
+    size_t seen = 0;
+    for (const auto& v : viewports)
+        for (const auto& state : world)
+            if (state.alive && state.npc->x >= v.x0 && state.npc->x <= v.x1 &&
+                state.npc->y >= v.y0 && state.npc->y <= v.y1)
+                ++seen;
+    const double scan_ms = std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << npcs << " NPCs, " << viewer_count << " viewers: collect "
+              << collect_ms / ticks << " ms/tick, full scans " << scan_ms
+              << " ms/tick, " << records / ticks << " records/tick, "
+              << seen / viewports.size() << " visible per viewer" << std::endl;
+    return 0;
+}
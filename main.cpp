@@ -2,6 +2,7 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdio>
 #include <cmath>
 #include <deque>
 #include <fstream>
@@ -10,6 +11,7 @@
 #include <mutex>
 #include <random>
 #include <shared_mutex>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -18,6 +20,15 @@
 #include "objects/dragon/dragon.hpp"
 #include "objects/princess/princess.hpp"
 #include "objects/knight/knight.hpp"
+#include "world/factory.hpp"
+#include "world/npc_registry.hpp"
+#include "world/compact_world.hpp"
+#include "world/view_server.hpp"
+#include "world/worker_pool.hpp"
+#include "world/simulation.hpp"
+#include "world/batch.hpp"
+#include "world/snapshot.hpp"
+#include "world/lock_profiler.hpp"
 
 namespace {
 constexpr int kMapWidth = 40;
@@ -26,120 +37,9 @@ constexpr size_t kInitialNpcCount = 50;
 constexpr std::chrono::seconds kSimulationDuration{30};
 constexpr std::chrono::milliseconds kMovementTick{200};
 constexpr std::chrono::milliseconds kPrintInterval{1000};
-constexpr double kTwoPi = 6.28318530717958647692;
+constexpr size_t kCheckpointEveryTicks = 25;
 }
 
-namespace detail {
-inline std::mutex console_mutex;
-}
-
-class TextObserver : public IFightObserver {
-private:
-    TextObserver() = default;
-
-public:
-    static std::shared_ptr<IFightObserver> get() {
-        static TextObserver instance;
-        return std::shared_ptr<IFightObserver>(&instance, [](IFightObserver*) {});
-    }
-
-    void on_fight(const std::shared_ptr<NPC> attacker,
-                  const std::shared_ptr<NPC> defender, bool win) override {
-        if (!win)
-            return;
-        std::lock_guard<std::mutex> lock(detail::console_mutex);
-        std::cout << std::endl << "Murder --------" << std::endl;
-        attacker->print(std::cout);
-        defender->print(std::cout);
-    }
-};
-
-class FileObserver : public IFightObserver {
-private:
-    std::ofstream fs;
-    FileObserver() { fs.open("log.txt"); }
-
-public:
-    ~FileObserver() { fs.close(); }
-    static std::shared_ptr<IFightObserver> get() {
-        static FileObserver instance;
-        return std::shared_ptr<IFightObserver>(&instance, [](IFightObserver*) {});
-    }
-
-    void on_fight(const std::shared_ptr<NPC> attacker,
-                  const std::shared_ptr<NPC> defender, bool win) override {
-        if (!win)
-            return;
-        fs << std::endl << "Murder --------" << std::endl;
-        attacker->print(fs);
-        defender->print(fs);
-    }
-};
-
-std::shared_ptr<NPC> factory(NpcType type, const std::string& name, int x, int y) {
-    std::shared_ptr<NPC> result;
-    switch (type) {
-    case DragonType:
-        result = std::make_shared<Dragon>(name, x, y);
-        break;
-    case PrincessType:
-        result = std::make_shared<Princess>(name, x, y);
-        break;
-    case KnightType:
-        result = std::make_shared<Knight>(name, x, y);
-        break;
-    default:
-        break;
-    }
-    if (result) {
-        result->subscribe(TextObserver::get());
-        result->subscribe(FileObserver::get());
-    }
-    return result;
-}
-
-const char* type_label(NpcType type) {
-    switch (type) {
-    case DragonType: return "Dragon";
-    case PrincessType: return "Princess";
-    case KnightType: return "Knight";
-    default: return "Unknown";
-    }
-}
-
-char symbol_for_type(NpcType type) {
-    switch (type) {
-    case DragonType: return 'D';
-    case PrincessType: return 'P';
-    case KnightType: return 'K';
-    default: return '?';
-    }
-}
-
-struct MovementAttributes {
-    double step;
-    size_t kill_distance;
-};
-
-MovementAttributes get_attributes(NpcType type) {
-    switch (type) {
-    case DragonType: return {50.0, 30};
-    case KnightType: return {30.0, 10};
-    case PrincessType: return {1.0, 1};
-    default: return {0.0, 0};
-    }
-}
-
-bool can_kill(NpcType attacker, NpcType defender) {
-    return (attacker == DragonType && defender == PrincessType) ||
-           (attacker == KnightType && defender == DragonType);
-}
-
-struct NPCState {
-    std::shared_ptr<NPC> npc;
-    bool alive{true};
-};
-
 struct FightTask {
     std::shared_ptr<NPC> attacker;
     std::shared_ptr<NPC> defender;
@@ -160,10 +60,11 @@ const NPCState* find_state(const std::vector<NPCState>& world,
     return nullptr;
 }
 
-void print_map(const std::vector<NPCState>& world, std::shared_mutex& world_mutex) {
+void print_map(const std::vector<NPCState>& world,
+               ProfiledMutex<std::shared_mutex>& world_mutex) {
     std::vector<std::string> grid(kMapHeight, std::string(kMapWidth, '.'));
     {
-        std::shared_lock<std::shared_mutex> lock(world_mutex);
+        ProfiledSharedLock lock(world_mutex);
         for (const auto& state : world) {
             if (!state.alive)
                 continue;
@@ -173,120 +74,235 @@ void print_map(const std::vector<NPCState>& world, std::shared_mutex& world_mute
             grid[npc->y][npc->x] = symbol_for_type(npc->type);
         }
     }
-    std::lock_guard<std::mutex> lock(detail::console_mutex);
+    ProfiledLock lock(detail::console_mutex);
     std::cout << "Map snapshot:" << std::endl;
     for (const auto& row : grid)
         std::cout << row << std::endl;
     std::cout << std::endl;
 }
 
-int main() {
-    std::vector<NPCState> world;
-    world.reserve(kInitialNpcCount);
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " [npc_count] [--memory-report] [--serve <socket>] [--checkpoint <file>]"
+              << " [--batch <runs> [--ticks <n>] [--quiet-interval <n>] [--summary <file>]]"
+              << std::endl;
+}
+
+// Whole-string unsigned number; std::stoull alone accepts "12abc" and "-1".
+size_t parse_count(const std::string& text) {
+    size_t used = 0;
+    if (text.empty() || text[0] == '-' || text[0] == '+')
+        throw std::invalid_argument(text);
+    size_t value = 0;
+    try {
+        value = std::stoull(text, &used);
+    } catch (const std::out_of_range&) {
+        throw std::out_of_range(text + " is too large");
+    }
+    if (used != text.size())
+        throw std::invalid_argument(text);
+    return value;
+}
+
+int main(int argc, char** argv) {
+    size_t npc_count = kInitialNpcCount;
+    bool memory_only = false;
+    std::string serve_path;
+    size_t batch_runs = 0;
+    size_t batch_ticks = SimulationConfig{}.ticks;
+    size_t quiet_interval = SimulationConfig{}.quiet_interval;
+    std::string summary_path = "batch_summary.txt";
+    std::string checkpoint_path;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument(arg + " needs a value");
+                return argv[++i];
+            };
+            if (arg == "--memory-report")
+                memory_only = true;
+            else if (arg == "--serve")
+                serve_path = value();
+            else if (arg == "--batch")
+                batch_runs = parse_count(value());
+            else if (arg == "--ticks")
+                batch_ticks = parse_count(value());
+            else if (arg == "--quiet-interval")
+                quiet_interval = std::max<size_t>(1, parse_count(value()));
+            else if (arg == "--summary")
+                summary_path = value();
+            else if (arg == "--checkpoint")
+                checkpoint_path = value();
+            else
+                npc_count = parse_count(arg);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Bad argument: " << e.what() << std::endl;
+        print_usage(argv[0]);
+        return 1;
+    }
 
     std::random_device rd;
-    std::mt19937 type_rng(rd());
-    std::uniform_int_distribution<int> type_dist(1, 3);
-    std::uniform_int_distribution<int> x_dist(0, kMapWidth - 1);
-    std::uniform_int_distribution<int> y_dist(0, kMapHeight - 1);
+    if (batch_runs > 0) {
+        SimulationConfig config;
+        config.width = kMapWidth;
+        config.height = kMapHeight;
+        config.npcs = npc_count;
+        config.ticks = batch_ticks;
+        config.quiet_interval = quiet_interval;
+        WorkerPool pool;
+        const auto summary = run_batch(config, batch_runs, rd(), pool);
+        std::ofstream out(summary_path);
+        out << summary;
+        std::cout << summary.runs << " runs in " << summary.seconds << " s: "
+                  << summary.runs_per_second() << " runs/s, summary in " << summary_path
+                  << std::endl;
+        return out ? 0 : 1;
+    }
 
-    for (size_t i = 0; i < kInitialNpcCount; ++i) {
-        NpcType type = static_cast<NpcType>(type_dist(type_rng));
-        std::string name = std::string(type_label(type)) + "_" + std::to_string(i);
-        auto npc = factory(type, name, x_dist(type_rng), y_dist(type_rng));
-        if (npc)
-            world.push_back({std::move(npc), true});
+    const auto startup_begin = std::chrono::steady_clock::now();
+    std::vector<NPCState> world;
+    factory(world, npc_count,
+            {{DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}},
+            kMapWidth, kMapHeight, rd());
+
+    if (memory_only) {
+        std::cout << "Objects: " << memory_report(world) << std::endl;
+        auto print_compact = [](const char* label, const auto& compact) {
+            std::cout << label << compact.size() << " NPCs, " << compact.memory_bytes()
+                      << " bytes (" << compact.bytes_per_npc() << " per NPC)" << std::endl;
+        };
+        CompactWorld compact;
+        WideCompactWorld wide;
+        if (compact_from(compact, world, kMapWidth, kMapHeight))
+            print_compact("Compact: ", compact);
+        else if (compact_from(wide, world, kMapWidth, kMapHeight))
+            print_compact("Compact (32-bit coordinates): ", wide);
+        else
+            std::cout << "Compact: not available for " << world.size() << " NPCs on a "
+                      << kMapWidth << "x" << kMapHeight << " map" << std::endl;
+        return 0;
+    }
+
+    std::unique_ptr<ViewServer> view_server;
+    if (!serve_path.empty()) {
+        view_server = std::make_unique<ViewServer>(kMapWidth, kMapHeight);
+        if (!view_server->listen(serve_path)) {
+            std::cerr << "Cannot listen on " << serve_path << std::endl;
+            return 1;
+        }
     }
 
-    std::shared_mutex world_mutex;
+    ProfiledMutex<std::shared_mutex> world_mutex{"world_mutex"};
     std::deque<FightTask> fight_queue;
-    std::mutex fight_mutex;
-    std::condition_variable fight_cv;
+    ProfiledMutex<std::mutex> fight_mutex{"fight_mutex"};
+    std::condition_variable_any fight_cv;
     std::atomic<bool> running{true};
 
+    // Movement and fight detection are split across a persistent pool; each
+    // worker has its own RNG and candidate buffer.
+    WorkerPool pool;
+    std::vector<std::mt19937> worker_rngs;
+    for (unsigned w = 0; w < pool.threads(); ++w)
+        worker_rngs.emplace_back(rd() + 1 + w);
+    std::vector<std::vector<FightTask>> worker_candidates(pool.threads());
+    TypeBatches batches;
+    TickStats movement_stats;
+    // Positions and liveness for checkpoints, published as a whole version
+    // at the end of every movement phase.
+    WorldPositions positions = positions_of(world);
+
     auto movement_thread = std::thread([&]() {
-        std::mt19937 rng(rd() + 1);
-        std::uniform_real_distribution<double> angle_dist(0.0, kTwoPi);
-        std::uniform_real_distribution<double> length_dist(0.0, 1.0);
-        while (running.load()) {
+        {
+            const auto startup = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - startup_begin);
+            ProfiledLock lock(detail::console_mutex);
+            std::cout << "World of " << world.size() << " NPCs ready, first tick after "
+                      << startup.count() << " ms" << std::endl;
+        }
+        TickPacer pacer(kMovementTick);
+        for (uint32_t tick = 0; running.load(); ++tick) {
+            if (view_server)
+                view_server->poll_viewers();
+            positions.prepare();
             {
-                std::lock_guard<std::shared_mutex> lock(world_mutex);
-                for (auto& state : world) {
-                    if (!state.alive)
-                        continue;
-                    const auto attr = get_attributes(state.npc->type);
-                    double angle = angle_dist(rng);
-                    double length = length_dist(rng) * attr.step;
-                    int dx = static_cast<int>(std::round(std::cos(angle) * length));
-                    int dy = static_cast<int>(std::round(std::sin(angle) * length));
-                    state.npc->x =
-                        std::clamp(state.npc->x + dx, 0, kMapWidth - 1);
-                    state.npc->y =
-                        std::clamp(state.npc->y + dy, 0, kMapHeight - 1);
-                }
+                ProfiledLock lock(world_mutex);
+                pool.run(world.size(), [&](size_t begin, size_t end, unsigned worker) {
+                    for (size_t i = begin; i < end; ++i) {
+                        auto& state = world[i];
+                        if (state.alive)
+                            move_npc(*state.npc, worker_rngs[worker], kMapWidth, kMapHeight);
+                        record_position(positions, i, state);
+                    }
+                });
+                positions.publish();
             }
 
+            // Only attacker/prey type pairs the registry allows are scanned,
+            // one batch of each type at a time. Viewers get this tick's frame
+            // under the same shared lock, so every move is streamed once.
             std::vector<FightTask> candidates;
             {
-                std::shared_lock<std::shared_mutex> lock(world_mutex);
-                const size_t count = world.size();
-                for (size_t i = 0; i < count; ++i) {
-                    const auto& attacker_state = world[i];
-                    if (!attacker_state.alive)
-                        continue;
-                    const auto attr = get_attributes(attacker_state.npc->type);
-                    if (attr.kill_distance == 0)
-                        continue;
-                    for (size_t j = 0; j < count; ++j) {
-                        if (i == j)
-                            continue;
-                        const auto& defender_state = world[j];
-                        if (!defender_state.alive)
-                            continue;
-                        if (!can_kill(attacker_state.npc->type, defender_state.npc->type))
-                            continue;
-                        if (attacker_state.npc->is_close(defender_state.npc, attr.kill_distance))
-                            candidates.push_back(
-                                {attacker_state.npc, defender_state.npc});
-                    }
-                }
+                ProfiledSharedLock lock(world_mutex);
+                batches.rebuild(world);
+                for (auto& found : worker_candidates)
+                    found.clear();
+                for_each_kill_pair([&](auto attacker_tag, auto prey_tag) {
+                    using Attacker = typename decltype(attacker_tag)::type;
+                    using Prey = typename decltype(prey_tag)::type;
+                    pool.run(batches.of<Attacker>().size(),
+                             [&](size_t begin, size_t end, unsigned worker) {
+                        auto& found = worker_candidates[worker];
+                        scan_kill_pair<Attacker, Prey>(world, batches, begin, end,
+                                                       [&](uint32_t a, uint32_t p) {
+                            found.push_back({world[a].npc, world[p].npc});
+                        });
+                    });
+                });
+                if (view_server)
+                    view_server->collect(tick, world);
             }
+            if (view_server)
+                view_server->flush();
+            for (auto& found : worker_candidates)
+                candidates.insert(candidates.end(), found.begin(), found.end());
 
             if (!candidates.empty()) {
                 {
-                    std::lock_guard<std::mutex> queue_lock(fight_mutex);
+                    ProfiledLock queue_lock(fight_mutex);
                     fight_queue.insert(fight_queue.end(),
                                        candidates.begin(), candidates.end());
                 }
                 fight_cv.notify_one();
             }
 
-            std::this_thread::sleep_for(kMovementTick);
+            pacer.wait();
         }
-        fight_cv.notify_all();
+        movement_stats = pacer.report();
     });
 
     auto fight_thread = std::thread([&]() {
         std::mt19937 dice_rng(rd() + 2);
         std::uniform_int_distribution<int> dice(1, 6);
-        while (running.load() || !fight_queue.empty()) {
+        for (;;) {
             FightTask task;
             {
-                std::unique_lock<std::mutex> queue_lock(fight_mutex);
+                ProfiledLock queue_lock(fight_mutex);
                 fight_cv.wait(queue_lock, [&]() {
                     return !fight_queue.empty() || !running.load();
                 });
-                if (fight_queue.empty()) {
-                    if (!running.load())
-                        break;
-                    continue;
-                }
+                // `running` is cleared under fight_mutex, so an empty queue
+                // here means shutdown and nothing is left to fight.
+                if (fight_queue.empty())
+                    break;
                 task = fight_queue.front();
                 fight_queue.pop_front();
             }
 
             {
-                std::shared_lock<std::shared_mutex> read_lock(world_mutex);
+                ProfiledSharedLock read_lock(world_mutex);
                 const auto* attacker_state = find_state(world, task.attacker);
                 const auto* defender_state = find_state(world, task.defender);
                 if (!attacker_state || !defender_state || !attacker_state->alive ||
@@ -302,11 +318,12 @@ int main() {
 
             bool killed = false;
             {
-                std::lock_guard<std::shared_mutex> write_lock(world_mutex);
+                ProfiledLock write_lock(world_mutex);
                 auto* attacker_state = find_state(world, task.attacker);
                 auto* defender_state = find_state(world, task.defender);
                 if (attacker_state && defender_state && attacker_state->alive &&
                     defender_state->alive) {
+                    // Reaches checkpoints with the next movement phase.
                     defender_state->alive = false;
                     killed = true;
                 }
@@ -317,6 +334,43 @@ int main() {
         }
     });
 
+    // The checkpoint thread only holds world_mutex to take an O(1) snapshot
+    // of the last published positions; writing it out happens while the
+    // simulation keeps running. Movement never copies on its behalf: a
+    // pinned version only makes the next prepare() allocate, outside the lock.
+    std::thread checkpoint_thread;
+    size_t checkpoints = 0;
+    std::chrono::nanoseconds checkpoint_pause_total{0};
+    std::chrono::nanoseconds checkpoint_pause_max{0};
+    if (!checkpoint_path.empty()) {
+        checkpoint_thread = std::thread([&]() {
+            TickPacer pacer(kMovementTick);
+            for (size_t tick = 1; running.load(); ++tick) {
+                pacer.wait();
+                if (tick % kCheckpointEveryTicks != 0)
+                    continue;
+                WorldPositions::Snapshot snapshot;
+                std::chrono::nanoseconds pause;
+                {
+                    ProfiledSharedLock lock(world_mutex);
+                    const auto pause_begin = std::chrono::steady_clock::now();
+                    snapshot = positions.snapshot();
+                    pause = std::chrono::steady_clock::now() - pause_begin;
+                }
+                ++checkpoints;
+                checkpoint_pause_total += pause;
+                checkpoint_pause_max = std::max(checkpoint_pause_max, pause);
+
+                const std::string tmp_path = checkpoint_path + ".tmp";
+                {
+                    std::ofstream out(tmp_path);
+                    write_checkpoint(out, world, snapshot);
+                }
+                std::rename(tmp_path.c_str(), checkpoint_path.c_str());
+            }
+        });
+    }
+
     auto start_time = std::chrono::steady_clock::now();
     auto next_print = start_time;
     const auto end_time = start_time + kSimulationDuration;
@@ -326,27 +380,42 @@ int main() {
         std::this_thread::sleep_until(next_print);
     }
 
-    running = false;
+    {
+        ProfiledLock queue_lock(fight_mutex);
+        running = false;
+    }
     fight_cv.notify_all();
     movement_thread.join();
     fight_thread.join();
+    if (checkpoint_thread.joinable())
+        checkpoint_thread.join();
 
     std::vector<std::shared_ptr<NPC>> survivors;
     {
-        std::shared_lock<std::shared_mutex> lock(world_mutex);
+        ProfiledSharedLock lock(world_mutex);
         for (const auto& state : world)
             if (state.alive)
                 survivors.push_back(state.npc);
     }
 
     {
-        std::lock_guard<std::mutex> lock(detail::console_mutex);
+        ProfiledLock lock(detail::console_mutex);
         std::cout << "Simulation finished. Survivors: " << survivors.size()
                   << std::endl;
+        std::cout << "Movement: " << movement_stats << std::endl;
+        if (checkpoints > 0)
+            std::cout << "Checkpoints: " << checkpoints << ", pause mean "
+                      << std::chrono::duration<double, std::micro>(
+                             checkpoint_pause_total / static_cast<long>(checkpoints)).count()
+                      << " us, max "
+                      << std::chrono::duration<double, std::micro>(checkpoint_pause_max).count()
+                      << " us, " << positions.allocations()
+                      << " position buffers allocated while pinned" << std::endl;
         for (const auto& npc : survivors)
-            std::cout << type_label(npc->type) << ": " << npc->name << " ("
+            std::cout << type_label(npc->type) << ": " << npc->display_name() << " ("
                       << npc->x << ", " << npc->y << ")" << std::endl;
     }
+    LockProfile::report_all(std::cout);
 
     return 0;
 }
@@ -2,57 +2,38 @@
 
 #include "../npc/npc.hpp"
 #include <memory>
+#include <type_traits>
+
+struct Dragon : public NpcKind<Dragon> {
+    static constexpr NpcType kType = DragonType;
+    static constexpr const char* kLabel = "Dragon";
+    static constexpr char kSymbol = 'D';
+    static constexpr double kStep = 50.0;
+    static constexpr size_t kKillDistance = 30;
+    template <typename Prey>
+    static constexpr bool kills = std::is_same_v<Prey, Princess>;
 
-struct Dragon : public NPC {
     Dragon(const std::string& name, int x, int y);
     Dragon(std::istream& is);
 
     void print(std::ostream& os) override;
-    void save(std::ostream& os) override;
-
-    bool visit(std::shared_ptr<Dragon> other) override;
-    bool visit(std::shared_ptr<Princess> other) override;
-    bool visit(std::shared_ptr<Knight> other) override;
-
-    bool accept(std::shared_ptr<NPC> attacker) override;
 
     friend std::ostream& operator<<(std::ostream& os, Dragon& dragon);
 };
 
+// Concrete types add no data and no vtable pointers to NPC.
+static_assert(sizeof(Dragon) == sizeof(NPC), "Dragon must be no larger than NPC");
+
 inline Dragon::Dragon(const std::string& name, int x, int y)
-    : NPC(DragonType, name, x, y) {}
+    : NpcKind(name, x, y) {}
 
-inline Dragon::Dragon(std::istream& is) : NPC(DragonType, is) {}
+inline Dragon::Dragon(std::istream& is) : NpcKind(is) {}
 
 inline void Dragon::print(std::ostream& os) {
     os << *this;
 }
 
-inline void Dragon::save(std::ostream& os) {
-    os << DragonType << std::endl;
-    NPC::save(os);
-}
-
-inline bool Dragon::visit(std::shared_ptr<Dragon> other) {
-    (void)other;
-    return false;
-}
-
-inline bool Dragon::visit(std::shared_ptr<Princess> other) {
-    fight_notify(std::static_pointer_cast<NPC>(other), true);
-    return true;
-}
-
-inline bool Dragon::visit(std::shared_ptr<Knight> other) {
-    (void)other;
-    return false;
-}
-
-inline bool Dragon::accept(std::shared_ptr<NPC> attacker) {
-    return attacker->visit(std::dynamic_pointer_cast<Dragon>(shared_from_this()));
-}
-
 inline std::ostream& operator<<(std::ostream& os, Dragon& dragon) {
-    os << "Dragon: " << dragon.name << " " << *static_cast<NPC*>(&dragon) << std::endl;
+    os << "Dragon: " << dragon.display_name() << " " << *static_cast<NPC*>(&dragon) << std::endl;
     return os;
 }
@@ -7,6 +7,7 @@
 #include <set>
 #include <cmath>
 #include <fstream>
+#include <cstddef>
 
 struct NPC;
 struct Dragon;
@@ -22,15 +23,52 @@ enum NpcType {
     KnightType = 3
 };
 
+template <typename... Ts>
+struct TypeList {};
+
+// Every concrete NPC type, in NpcType order. The visit interface below, the
+// NpcKind overrides and all tables in world/npc_registry.hpp are generated
+// from this list. A new type needs a header in objects/ deriving from
+// NpcKind with its traits, an NpcType value and an entry here.
+using NpcTypes = TypeList<Dragon, Princess, Knight>;
+
+// One pure visit() per type, declared along a single inheritance chain so
+// that NPC keeps one vtable pointer (separate bases would add one each).
+template <typename... Ts>
+struct VisitChain;
+
+template <typename T>
+struct VisitChain<T> {
+    virtual bool visit(std::shared_ptr<T> other) = 0;
+    virtual ~VisitChain() = default;
+};
+
+template <typename T, typename... Rest>
+struct VisitChain<T, Rest...> : VisitChain<Rest...> {
+    using VisitChain<Rest...>::visit;
+    virtual bool visit(std::shared_ptr<T> other) = 0;
+};
+
+template <typename List>
+struct Visitor;
+
+template <typename... Ts>
+struct Visitor<TypeList<Ts...>> : VisitChain<Ts...> {};
+
 struct IFightObserver {
     virtual void on_fight(const std::shared_ptr<NPC> attacker,
                           const std::shared_ptr<NPC> defender, bool win) = 0;
     virtual ~IFightObserver() = default;
 };
 
-struct NPC : public std::enable_shared_from_this<NPC> {
+struct NPC : public std::enable_shared_from_this<NPC>, public Visitor<NpcTypes> {
+    static constexpr size_t kNoId = static_cast<size_t>(-1);
+
     NpcType type;
     std::string name;
+    // Bulk-spawned NPCs leave `name` empty and get an id instead; the
+    // "<Type>_<id>" name is only built when somebody asks for it.
+    size_t id{kNoId};
     int x{0};
     int y{0};
     std::vector<std::shared_ptr<IFightObserver>> observers;
@@ -38,15 +76,13 @@ struct NPC : public std::enable_shared_from_this<NPC> {
     NPC(NpcType t, const std::string& n, int _x, int _y);
     NPC(NpcType t, std::istream& is);
 
+    std::string display_name() const;
     void subscribe(std::shared_ptr<IFightObserver> observer);
     void fight_notify(const std::shared_ptr<NPC> defender, bool win);
     bool is_close(const std::shared_ptr<NPC>& other, size_t distance) const;
 
-    virtual bool visit(std::shared_ptr<Dragon> other) = 0;
-    virtual bool visit(std::shared_ptr<Princess> other) = 0;
-    virtual bool visit(std::shared_ptr<Knight> other) = 0;
-
     virtual bool accept(std::shared_ptr<NPC> attacker) = 0;
+    virtual const char* label() const = 0;
 
     virtual void print(std::ostream& os) = 0;
     virtual void save(std::ostream& os);
@@ -56,6 +92,22 @@ struct NPC : public std::enable_shared_from_this<NPC> {
     friend std::ostream& operator<<(std::ostream& os, NPC& npc);
 };
 
+namespace detail {
+// NPC's data members next to exactly one vtable pointer.
+struct NpcSingleVptrLayout {
+    void* vptr;
+    std::weak_ptr<NPC> weak_this;
+    NpcType type;
+    std::string name;
+    size_t id;
+    int x;
+    int y;
+    std::vector<std::shared_ptr<IFightObserver>> observers;
+};
+}
+static_assert(sizeof(NPC) == sizeof(detail::NpcSingleVptrLayout),
+              "NPC must carry a single vtable pointer");
+
 inline NPC::NPC(NpcType t, const std::string& n, int _x, int _y)
     : type(t), name(n), x(_x), y(_y) {}
 
@@ -63,6 +115,12 @@ inline NPC::NPC(NpcType t, std::istream& is) : type(t) {
     is >> name >> x >> y;
 }
 
+inline std::string NPC::display_name() const {
+    if (id == kNoId)
+        return name;
+    return std::string(label()) + "_" + std::to_string(id);
+}
+
 inline void NPC::subscribe(std::shared_ptr<IFightObserver> observer) {
     observers.push_back(observer);
 }
@@ -82,10 +140,58 @@ inline bool NPC::is_close(const std::shared_ptr<NPC>& other, size_t distance) co
 }
 
 inline void NPC::save(std::ostream& os) {
-    os << name << std::endl << x << std::endl << y << std::endl;
+    os << display_name() << std::endl << x << std::endl << y << std::endl;
 }
 
 inline std::ostream& operator<<(std::ostream& os, NPC& npc) {
     os << "{ x:" << npc.x << ", y:" << npc.y << "} ";
     return os;
 }
+
+// Implements visit() for every type in NpcTypes from Self::kills<Prey>: a
+// kill notifies the attacker's observers, anything else is a no-op.
+template <typename Self, typename List>
+struct Hunter;
+
+template <typename Self>
+struct Hunter<Self, TypeList<>> : public NPC {
+    using NPC::NPC;
+};
+
+template <typename Self, typename Prey, typename... Rest>
+struct Hunter<Self, TypeList<Prey, Rest...>> : public Hunter<Self, TypeList<Rest...>> {
+    using Base = Hunter<Self, TypeList<Rest...>>;
+    using Base::Base;
+    using Base::visit;
+
+    bool visit(std::shared_ptr<Prey> other) override {
+        if constexpr (Self::template kills<Prey>) {
+            this->fight_notify(std::static_pointer_cast<NPC>(other), true);
+            return true;
+        } else {
+            (void)other;
+            return false;
+        }
+    }
+};
+
+// Base for concrete NPCs. Self provides kType, kLabel, kSymbol, kStep,
+// kKillDistance and `template <typename Prey> static constexpr bool kills`.
+template <typename Self>
+struct NpcKind : public Hunter<Self, NpcTypes> {
+    using Base = Hunter<Self, NpcTypes>;
+
+    NpcKind(const std::string& name, int x, int y) : Base(Self::kType, name, x, y) {}
+    NpcKind(std::istream& is) : Base(Self::kType, is) {}
+
+    bool accept(std::shared_ptr<NPC> attacker) override {
+        return attacker->visit(std::static_pointer_cast<Self>(this->shared_from_this()));
+    }
+
+    const char* label() const override { return Self::kLabel; }
+
+    void save(std::ostream& os) override {
+        os << Self::kType << std::endl;
+        NPC::save(os);
+    }
+};
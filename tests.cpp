@@ -1,10 +1,24 @@
 #include <gtest/gtest.h>
 #include <sstream>
 #include <fstream>
+#include <cstdio>
 #include "objects/npc/npc.hpp"
 #include "objects/dragon/dragon.hpp"
 #include "objects/princess/princess.hpp"
 #include "objects/knight/knight.hpp"
+#include "world/factory.hpp"
+#include "world/npc_registry.hpp"
+#include "world/compact_world.hpp"
+#include "world/spatial_grid.hpp"
+#include "world/view_server.hpp"
+#include "world/worker_pool.hpp"
+#include "world/simulation.hpp"
+#include "world/batch.hpp"
+#include "world/snapshot.hpp"
+#include "world/lock_profiler.hpp"
+#include <condition_variable>
+#include <shared_mutex>
+#include <unistd.h>
 
 TEST(NPCCreation, CreateDragon) {
     Dragon d("D", 10, 20);
@@ -241,6 +255,870 @@ TEST(EdgeCases, LargeCoordinates) {
     EXPECT_EQ(d.y, 200000);
 }
 
+TEST(BulkFactory, FillsRequestedCount) {
+    std::vector<NPCState> world;
+    factory(world, 1000, {{DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}},
+            40, 20, 7, 2);
+    ASSERT_EQ(world.size(), static_cast<size_t>(1000));
+    for (size_t i = 0; i < world.size(); ++i) {
+        ASSERT_TRUE(world[i].npc);
+        EXPECT_TRUE(world[i].alive);
+        EXPECT_EQ(world[i].npc->id, i);
+        EXPECT_GE(world[i].npc->x, 0);
+        EXPECT_LT(world[i].npc->x, 40);
+        EXPECT_GE(world[i].npc->y, 0);
+        EXPECT_LT(world[i].npc->y, 20);
+        EXPECT_EQ(world[i].npc->observers.size(), static_cast<size_t>(2));
+    }
+}
+
+TEST(BulkFactory, SameSeedSameWorldForAnyThreadCount) {
+    std::vector<NPCState> serial;
+    std::vector<NPCState> parallel;
+    const std::vector<SpawnShare> shares{{DragonType, 1.0}, {KnightType, 2.0}};
+    factory(serial, 3 * kSpawnChunk + 5, shares, 100, 100, 11, 1);
+    factory(parallel, 3 * kSpawnChunk + 5, shares, 100, 100, 11, 4);
+    ASSERT_EQ(serial.size(), parallel.size());
+    for (size_t i = 0; i < serial.size(); ++i) {
+        ASSERT_EQ(serial[i].npc->type, parallel[i].npc->type);
+        ASSERT_EQ(serial[i].npc->x, parallel[i].npc->x);
+        ASSERT_EQ(serial[i].npc->y, parallel[i].npc->y);
+    }
+}
+
+TEST(BulkFactory, RespectsTypeShares) {
+    std::vector<NPCState> world;
+    factory(world, 500, {{PrincessType, 1.0}, {Unknown, 5.0}, {DragonType, 0.0}},
+            10, 10, 3);
+    ASSERT_EQ(world.size(), static_cast<size_t>(500));
+    for (const auto& state : world)
+        EXPECT_EQ(state.npc->type, PrincessType);
+}
+
+TEST(BulkFactory, AppendsAfterExistingNpcs) {
+    std::vector<NPCState> world;
+    world.push_back({factory(DragonType, "Smaug", 1, 1), true});
+    factory(world, 10, {{KnightType, 1.0}}, 10, 10, 5);
+    ASSERT_EQ(world.size(), static_cast<size_t>(11));
+    EXPECT_EQ(world[0].npc->display_name(), "Smaug");
+    EXPECT_EQ(world[10].npc->id, static_cast<size_t>(10));
+}
+
+TEST(BulkFactory, LazyNamesAreGeneratedOnDemand) {
+    std::vector<NPCState> world;
+    factory(world, 3, {{KnightType, 1.0}}, 10, 10, 5);
+    EXPECT_EQ(world[2].npc->name, "");
+    EXPECT_EQ(world[2].npc->display_name(), "Knight_2");
+
+    std::stringstream ss;
+    world[2].npc->save(ss);
+    int type;
+    ss >> type;
+    Knight loaded(ss);
+    EXPECT_EQ(loaded.name, "Knight_2");
+}
+
+TEST(MemoryReport, CountsEveryPart) {
+    std::vector<NPCState> world;
+    world.push_back({factory(DragonType, "A dragon with a rather long name", 0, 0), true});
+    const auto memory = npc_memory(*world[0].npc);
+    EXPECT_EQ(memory.object, sizeof(Dragon));
+    EXPECT_GT(memory.name_heap, static_cast<size_t>(0));
+    EXPECT_GE(memory.observers_heap, 2 * sizeof(std::shared_ptr<IFightObserver>));
+    EXPECT_GT(memory.total(), static_cast<size_t>(100));
+
+    const auto report = memory_report(world);
+    EXPECT_EQ(report.npcs, static_cast<size_t>(1));
+    EXPECT_EQ(report.bytes.total(), memory.total());
+}
+
+TEST(CompactWorld, MatchesBulkFactory) {
+    const std::vector<SpawnShare> shares{{DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}};
+    std::vector<NPCState> objects;
+    CompactWorld compact;
+    factory(objects, 2000, shares, 300, 200, 9);
+    ASSERT_TRUE(compact_factory(compact, 2000, shares, 300, 200, 9));
+    ASSERT_EQ(compact.size(), objects.size());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        ASSERT_EQ(compact.type_of(i), objects[i].npc->type);
+        ASSERT_EQ(compact.x[i], objects[i].npc->x);
+        ASSERT_EQ(compact.y[i], objects[i].npc->y);
+        ASSERT_EQ(compact.name_of(i), objects[i].npc->display_name());
+    }
+    EXPECT_LT(compact.bytes_per_npc(), 12.0);
+    EXPECT_GT(memory_report(objects).bytes_per_npc(), 100.0);
+}
+
+TEST(CompactWorld, RejectsMapsBeyond16Bits) {
+    CompactWorld compact;
+    EXPECT_TRUE(CompactWorld::fits(65536, 10, 1));
+    EXPECT_FALSE(CompactWorld::fits(65537, 10, 1));
+    EXPECT_FALSE(compact_factory(compact, 10, {{DragonType, 1.0}}, 10, 70000, 1));
+    EXPECT_EQ(compact.size(), static_cast<size_t>(0));
+}
+
+TEST(CompactWorld, WideCoordinatesCoverLargeMaps) {
+    WideCompactWorld wide;
+    ASSERT_TRUE(compact_factory(wide, 500, {{DragonType, 1.0}}, 10, 70000, 1));
+    EXPECT_EQ(wide.size(), static_cast<size_t>(500));
+    bool beyond_16_bits = false;
+    for (size_t i = 0; i < wide.size(); ++i) {
+        EXPECT_LT(wide.y[i], 70000u);
+        beyond_16_bits = beyond_16_bits || wide.y[i] > 65535u;
+    }
+    EXPECT_TRUE(beyond_16_bits);
+    EXPECT_EQ(wide.expand(0)->y, static_cast<int>(wide.y[0]));
+}
+
+TEST(CompactWorld, KeepsCustomNamesAndRoundTrips) {
+    std::vector<NPCState> world;
+    world.push_back({factory(PrincessType, "Fiona", 3, 4), true});
+    world.push_back({factory(KnightType, "", 5, 6), false});
+    CompactWorld compact;
+    ASSERT_TRUE(compact_from(compact, world, 40, 20));
+    EXPECT_EQ(compact.name_of(0), "Fiona");
+    EXPECT_EQ(compact.name_of(1), "");
+    EXPECT_TRUE(compact.alive[0]);
+    EXPECT_FALSE(compact.alive[1]);
+
+    auto npc = compact.expand(0);
+    EXPECT_EQ(npc->type, PrincessType);
+    EXPECT_EQ(npc->display_name(), "Fiona");
+    EXPECT_EQ(npc->x, 3);
+    EXPECT_EQ(npc->y, 4);
+}
+
+TEST(SpatialGrid, QueryMatchesBruteForce) {
+    std::vector<NPCState> world;
+    factory(world, 3000, {{DragonType, 1.0}, {PrincessType, 1.0}}, 100, 70, 21);
+    for (size_t i = 0; i < world.size(); i += 7)
+        world[i].alive = false;
+
+    SpatialGrid grid(100, 70, 8);
+    grid.rebuild(world.size(), [&](size_t i, int& x, int& y) {
+        x = world[i].npc->x;
+        y = world[i].npc->y;
+        return world[i].alive;
+    });
+
+    const Viewport rects[] = {{0, 0, 99, 69}, {10, 5, 30, 40}, {63, 63, 64, 64}, {-5, -5, 3, 3}};
+    for (const auto& r : rects) {
+        std::set<uint32_t> expected;
+        for (size_t i = 0; i < world.size(); ++i) {
+            const auto& npc = world[i].npc;
+            if (world[i].alive && npc->x >= r.x0 && npc->x <= r.x1 && npc->y >= r.y0 &&
+                npc->y <= r.y1)
+                expected.insert(static_cast<uint32_t>(i));
+        }
+        std::set<uint32_t> found;
+        grid.query(r.x0, r.y0, r.x1, r.y1,
+                   [&](const SpatialGrid::Entry& entry) { found.insert(entry.index); });
+        EXPECT_EQ(found, expected);
+    }
+}
+
+namespace {
+std::string view_socket_path() {
+    return "/tmp/oop_lab_view_" + std::to_string(::getpid()) + ".sock";
+}
+
+void expect_sees_exactly(const ViewClient& client, const Viewport& v,
+                         const std::vector<NPCState>& world) {
+    size_t expected = 0;
+    for (size_t i = 0; i < world.size(); ++i) {
+        const auto& npc = world[i].npc;
+        const bool inside = world[i].alive && npc->x >= v.x0 && npc->x <= v.x1 &&
+                            npc->y >= v.y0 && npc->y <= v.y1;
+        auto it = client.visible.find(static_cast<uint32_t>(i));
+        if (!inside) {
+            EXPECT_TRUE(it == client.visible.end()) << "npc " << i;
+            continue;
+        }
+        ++expected;
+        ASSERT_TRUE(it != client.visible.end()) << "npc " << i;
+        EXPECT_EQ(it->second.x, npc->x);
+        EXPECT_EQ(it->second.y, npc->y);
+        EXPECT_EQ(it->second.type, npc->type);
+    }
+    EXPECT_EQ(client.visible.size(), expected);
+}
+}
+
+TEST(ViewServer, StreamsViewportDeltasToManyClients) {
+    constexpr int kWidth = 200;
+    constexpr int kHeight = 120;
+    constexpr int kClients = 64;
+    std::vector<NPCState> world;
+    factory(world, 5000, {{DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}},
+            kWidth, kHeight, 4);
+
+    const auto path = view_socket_path();
+    ViewServer server(kWidth, kHeight);
+    ASSERT_TRUE(server.listen(path));
+
+    std::vector<std::unique_ptr<ViewClient>> clients;
+    std::vector<Viewport> viewports;
+    for (int c = 0; c < kClients; ++c) {
+        clients.push_back(std::make_unique<ViewClient>());
+        ASSERT_TRUE(clients.back()->connect(path));
+        const int x0 = (c * 37) % (kWidth - 30);
+        const int y0 = (c * 23) % (kHeight - 20);
+        viewports.push_back({x0, y0, x0 + 10 + c % 20, y0 + 5 + c % 15});
+        ASSERT_TRUE(clients.back()->request(viewports.back()));
+    }
+
+    std::mt19937 rng(8);
+    std::uniform_int_distribution<int> step(-3, 3);
+    std::uniform_int_distribution<size_t> pick(0, world.size() - 1);
+    for (uint32_t tick = 0; tick < 5; ++tick) {
+        if (tick > 0) {
+            for (auto& state : world) {
+                state.npc->x = std::clamp(state.npc->x + step(rng), 0, kWidth - 1);
+                state.npc->y = std::clamp(state.npc->y + step(rng), 0, kHeight - 1);
+            }
+            for (int k = 0; k < 200; ++k)
+                world[pick(rng)].alive = false;
+        }
+        server.publish(tick, world);
+        EXPECT_EQ(server.viewer_count(), static_cast<size_t>(kClients));
+        for (int c = 0; c < kClients; ++c) {
+            ViewFrameHeader header{};
+            std::vector<ViewDelta> deltas;
+            ASSERT_TRUE(clients[c]->receive(header, deltas));
+            EXPECT_EQ(header.tick, tick);
+            expect_sees_exactly(*clients[c], viewports[c], world);
+        }
+    }
+}
+
+TEST(ViewServer, ReportsDeathsAndViewportChanges) {
+    std::vector<NPCState> world;
+    world.push_back({factory(DragonType, "D", 5, 5), true});
+    world.push_back({factory(PrincessType, "P", 6, 5), true});
+    world.push_back({factory(KnightType, "K", 30, 15), true});
+
+    const auto path = view_socket_path();
+    ViewServer server(40, 20, 4);
+    ASSERT_TRUE(server.listen(path));
+    ViewClient client;
+    ASSERT_TRUE(client.connect(path));
+    ASSERT_TRUE(client.request({0, 0, 9, 9}));
+
+    ViewFrameHeader header{};
+    std::vector<ViewDelta> deltas;
+    server.publish(1, world);
+    ASSERT_TRUE(client.receive(header, deltas));
+    ASSERT_EQ(deltas.size(), static_cast<size_t>(2));
+    EXPECT_EQ(deltas[0].kind, ViewEnter);
+    EXPECT_EQ(deltas[1].kind, ViewEnter);
+
+    world[1].alive = false;
+    world[0].npc->x = 7;
+    server.publish(2, world);
+    ASSERT_TRUE(client.receive(header, deltas));
+    ASSERT_EQ(deltas.size(), static_cast<size_t>(2));
+    EXPECT_EQ(deltas[0].id, 0u);
+    EXPECT_EQ(deltas[0].kind, ViewMove);
+    EXPECT_EQ(deltas[0].x, 7);
+    EXPECT_EQ(deltas[1].id, 1u);
+    EXPECT_EQ(deltas[1].kind, ViewDeath);
+
+    server.publish(3, world);
+    ASSERT_TRUE(client.receive(header, deltas));
+    EXPECT_TRUE(deltas.empty());
+
+    ASSERT_TRUE(client.request({20, 10, 39, 19}));
+    server.publish(4, world);
+    ASSERT_TRUE(client.receive(header, deltas));
+    ASSERT_EQ(deltas.size(), static_cast<size_t>(2));
+    EXPECT_EQ(deltas[0].id, 0u);
+    EXPECT_EQ(deltas[0].kind, ViewLeave);
+    EXPECT_EQ(deltas[1].id, 2u);
+    EXPECT_EQ(deltas[1].kind, ViewEnter);
+    EXPECT_EQ(client.visible.size(), static_cast<size_t>(1));
+}
+
+TEST(ViewServer, ForgetsDisconnectedViewers) {
+    std::vector<NPCState> world;
+    world.push_back({factory(DragonType, "D", 5, 5), true});
+    const auto path = view_socket_path();
+    ViewServer server(40, 20);
+    ASSERT_TRUE(server.listen(path));
+    {
+        ViewClient client;
+        ASSERT_TRUE(client.connect(path));
+        ASSERT_TRUE(client.request({0, 0, 39, 19}));
+        server.publish(0, world);
+        EXPECT_EQ(server.viewer_count(), static_cast<size_t>(1));
+    }
+    server.publish(1, world);
+    server.publish(2, world);
+    EXPECT_EQ(server.viewer_count(), static_cast<size_t>(0));
+}
+
+TEST(ViewServer, ListenKeepsExistingFiles) {
+    const auto path = view_socket_path();
+    {
+        std::ofstream file(path);
+        file << "precious";
+    }
+    ViewServer server(40, 20);
+    EXPECT_FALSE(server.listen(path));
+    EXPECT_EQ(errno, EEXIST);
+    std::ifstream file(path);
+    std::string contents;
+    file >> contents;
+    EXPECT_EQ(contents, "precious");
+    std::remove(path.c_str());
+
+    // A socket left behind by an earlier server is replaced.
+    {
+        ViewServer first(40, 20);
+        ASSERT_TRUE(first.listen(path));
+        ViewServer second(40, 20);
+        EXPECT_TRUE(second.listen(path));
+    }
+}
+
+TEST(ViewServer, CollectLeavesSocketsToPollViewers) {
+    std::vector<NPCState> world;
+    world.push_back({factory(DragonType, "D", 5, 5), true});
+    const auto path = view_socket_path();
+    ViewServer server(40, 20);
+    ASSERT_TRUE(server.listen(path));
+    ViewClient client;
+    ASSERT_TRUE(client.connect(path));
+    ASSERT_TRUE(client.request({0, 0, 39, 19}));
+
+    server.collect(0, world);
+    EXPECT_EQ(server.viewer_count(), static_cast<size_t>(0));
+
+    server.poll_viewers();
+    EXPECT_EQ(server.viewer_count(), static_cast<size_t>(1));
+    server.collect(1, world);
+    server.flush();
+    ViewFrameHeader header{};
+    std::vector<ViewDelta> deltas;
+    ASSERT_TRUE(client.receive(header, deltas));
+    EXPECT_EQ(header.tick, 1u);
+    EXPECT_EQ(deltas.size(), static_cast<size_t>(1));
+}
+
+TEST(PhaseBarrier, KeepsThreadsInLockstep) {
+    constexpr size_t kThreads = 4;
+    constexpr int kPhases = 200;
+    PhaseBarrier barrier(kThreads, 16);
+    std::atomic<int> arrived{0};
+    std::atomic<bool> out_of_step{false};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&]() {
+            for (int phase = 0; phase < kPhases; ++phase) {
+                ++arrived;
+                barrier.arrive_and_wait();
+                if (arrived.load() < static_cast<int>((phase + 1) * kThreads))
+                    out_of_step = true;
+                barrier.arrive_and_wait();
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_FALSE(out_of_step.load());
+    EXPECT_EQ(arrived.load(), static_cast<int>(kPhases * kThreads));
+}
+
+TEST(WorkerPool, CoversRangeExactlyOnceAcrossRuns) {
+    WorkerPool pool(3);
+    EXPECT_EQ(pool.threads(), 3u);
+    for (size_t count : {0, 1, 2, 10, 1001}) {
+        std::vector<std::atomic<int>> hits(count);
+        std::atomic<unsigned> workers_seen{0};
+        pool.run(count, [&](size_t begin, size_t end, unsigned worker) {
+            workers_seen |= 1u << worker;
+            for (size_t i = begin; i < end; ++i)
+                ++hits[i];
+        });
+        for (size_t i = 0; i < count; ++i)
+            ASSERT_EQ(hits[i].load(), 1) << "count " << count << " index " << i;
+        EXPECT_EQ(workers_seen.load(), 7u);
+    }
+}
+
+// Time only moves when a test advances it or the pacer sleeps.
+struct FakeClock {
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<FakeClock>;
+    static constexpr bool is_steady = true;
+
+    static inline time_point current{};
+
+    static time_point now() { return current; }
+    static void sleep_until(time_point deadline) { current = std::max(current, deadline); }
+    static void advance(duration d) { current += d; }
+};
+
+TEST(TickPacer, DoesNotDriftWithWork) {
+    using namespace std::chrono;
+    const auto begin = FakeClock::now();
+    BasicTickPacer<FakeClock> pacer(milliseconds(10), begin);
+    for (int tick = 0; tick < 10; ++tick) {
+        FakeClock::advance(milliseconds(4));
+        pacer.wait();
+    }
+    // A fixed sleep after the work would end at 140 ms.
+    EXPECT_EQ(FakeClock::now() - begin, milliseconds(100));
+    EXPECT_EQ(pacer.report().ticks, static_cast<size_t>(10));
+    EXPECT_EQ(pacer.report().overruns, static_cast<size_t>(0));
+    EXPECT_EQ(pacer.report().max_jitter, nanoseconds(0));
+}
+
+TEST(TickPacer, SkipsWholeMissedPeriods) {
+    using namespace std::chrono;
+    const auto begin = FakeClock::now();
+    BasicTickPacer<FakeClock> pacer(milliseconds(5), begin);
+    FakeClock::advance(milliseconds(18));
+    pacer.wait();
+    EXPECT_EQ(pacer.report().overruns, static_cast<size_t>(1));
+    EXPECT_EQ(pacer.report().skipped, static_cast<size_t>(2));
+    EXPECT_EQ(pacer.report().max_jitter, milliseconds(13));
+    EXPECT_EQ(FakeClock::now() - begin, milliseconds(18));
+
+    // Back on the grid: the deadlines at 10 and 15 ms were dropped.
+    pacer.wait();
+    EXPECT_EQ(FakeClock::now() - begin, milliseconds(20));
+    EXPECT_EQ(pacer.report().overruns, static_cast<size_t>(1));
+}
+
+TEST(TickPacer, SleepsInRealTime) {
+    using namespace std::chrono;
+    const auto begin = steady_clock::now();
+    TickPacer pacer(milliseconds(5), begin);
+    for (int tick = 0; tick < 3; ++tick)
+        pacer.wait();
+    EXPECT_GE(steady_clock::now() - begin, milliseconds(15));
+}
+
+TEST(NpcRegistry, TablesFollowClassTraits) {
+    EXPECT_STREQ(type_label(DragonType), "Dragon");
+    EXPECT_STREQ(type_label(PrincessType), "Princess");
+    EXPECT_STREQ(type_label(KnightType), "Knight");
+    EXPECT_STREQ(type_label(Unknown), "Unknown");
+    EXPECT_STREQ(type_label(static_cast<NpcType>(42)), "Unknown");
+    EXPECT_EQ(symbol_for_type(DragonType), 'D');
+    EXPECT_EQ(symbol_for_type(KnightType), 'K');
+    EXPECT_EQ(symbol_for_type(Unknown), '?');
+    EXPECT_EQ(get_attributes(DragonType).step, 50.0);
+    EXPECT_EQ(get_attributes(DragonType).kill_distance, static_cast<size_t>(30));
+    EXPECT_EQ(get_attributes(KnightType).kill_distance, static_cast<size_t>(10));
+    EXPECT_EQ(get_attributes(Unknown).kill_distance, static_cast<size_t>(0));
+    static_assert(can_kill(DragonType, PrincessType));
+    static_assert(can_kill(KnightType, DragonType));
+    static_assert(!can_kill(PrincessType, DragonType));
+    static_assert(!can_kill(Unknown, PrincessType));
+}
+
+TEST(NpcRegistry, FactoryBuildsEveryType) {
+    for_each_npc_type([](auto tag) {
+        using T = typename decltype(tag)::type;
+        auto npc = make_npc(T::kType, "n", 1, 2);
+        ASSERT_TRUE(npc);
+        EXPECT_EQ(npc->type, T::kType);
+        EXPECT_TRUE(std::dynamic_pointer_cast<T>(npc) != nullptr);
+        EXPECT_STREQ(npc->label(), T::kLabel);
+    });
+    EXPECT_FALSE(make_npc(Unknown, "n", 0, 0));
+}
+
+TEST(NpcRegistry, AllDispatchPathsAgree) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for_each_npc_type([&](auto tag) {
+        npcs.push_back(make_npc(decltype(tag)::type::kType, "n", 0, 0));
+    });
+    for (const auto& attacker : npcs) {
+        for (const auto& defender : npcs) {
+            const bool table = can_kill(attacker->type, defender->type);
+            EXPECT_EQ(can_kill(npc_ref(*attacker), npc_ref(*defender)), table);
+            EXPECT_EQ(defender->accept(attacker), table);
+        }
+    }
+}
+
+TEST(NpcRegistry, BatchesGroupLiveNpcsByType) {
+    std::vector<NPCState> world;
+    world.push_back({make_npc(KnightType, "k0", 0, 0), true});
+    world.push_back({make_npc(DragonType, "d0", 0, 0), true});
+    world.push_back({make_npc(KnightType, "k1", 0, 0), false});
+    world.push_back({make_npc(KnightType, "k2", 0, 0), true});
+    TypeBatches batches;
+    batches.rebuild(world);
+    EXPECT_EQ(batches.of<Knight>(), (std::vector<uint32_t>{0, 3}));
+    EXPECT_EQ(batches.of<Dragon>(), (std::vector<uint32_t>{1}));
+    EXPECT_TRUE(batches.of<Princess>().empty());
+
+    int pairs = 0;
+    for_each_kill_pair([&](auto, auto) { ++pairs; });
+    EXPECT_EQ(pairs, 2);
+}
+
+TEST(Simulation, SameSeedSameOutcome) {
+    SimulationConfig config;
+    config.npcs = 200;
+    config.ticks = 40;
+    Simulation a(config, 77);
+    Simulation b(config, 77);
+    a.run();
+    b.run();
+    EXPECT_EQ(a.current_tick(), static_cast<size_t>(40));
+    EXPECT_EQ(a.survivors(), b.survivors());
+    ASSERT_EQ(a.kills().size(), b.kills().size());
+    for (size_t i = 0; i < a.npcs().size(); ++i) {
+        EXPECT_EQ(a.npcs()[i].alive, b.npcs()[i].alive);
+        EXPECT_EQ(a.npcs()[i].npc->x, b.npcs()[i].npc->x);
+    }
+}
+
+TEST(Simulation, OnlyAllowedKillsHappen) {
+    SimulationConfig config;
+    config.npcs = 300;
+    config.ticks = 30;
+    Simulation simulation(config, 5);
+    simulation.run();
+    ASSERT_FALSE(simulation.kills().empty());
+    for (const auto& kill : simulation.kills()) {
+        EXPECT_TRUE(can_kill(kill.attacker, kill.defender));
+        EXPECT_LT(kill.tick, 30u);
+    }
+    size_t alive = 0;
+    for (const auto& count : simulation.survivors())
+        alive += count;
+    EXPECT_EQ(alive + simulation.kills().size(), static_cast<size_t>(300));
+    for (const auto& state : simulation.npcs()) {
+        EXPECT_TRUE(state.npc->observers.empty());
+        EXPECT_GE(state.npc->x, 0);
+        EXPECT_LT(state.npc->x, config.width);
+    }
+}
+
+TEST(RegionActivity, ActiveOnlyNearHunterAndPrey) {
+    std::vector<NPCState> world;
+    world.push_back({make_npc(DragonType, "d", 5, 5), true});
+    world.push_back({make_npc(PrincessType, "p", 40, 5), true});
+    world.push_back({make_npc(PrincessType, "far", 150, 10), true});
+    world.push_back({make_npc(KnightType, "k", 200, 200), true});
+
+    RegionActivity regions;
+    regions.reset(300, 300);
+    EXPECT_EQ(regions.region_size(), kMaxKillDistance);
+    regions.classify(world);
+    EXPECT_TRUE(regions.active(5, 5));
+    EXPECT_TRUE(regions.active(40, 5));
+    EXPECT_FALSE(regions.active(150, 10));
+    EXPECT_FALSE(regions.active(200, 200));
+    EXPECT_EQ(regions.active_regions(), static_cast<size_t>(2));
+
+    world[1].alive = false;
+    regions.classify(world);
+    EXPECT_EQ(regions.active_regions(), static_cast<size_t>(0));
+}
+
+TEST(RegionActivity, ActiveFilterKeepsEveryKillCandidate) {
+    auto candidates = [](const std::vector<NPCState>& world, const TypeBatches& batches) {
+        std::vector<std::pair<uint32_t, uint32_t>> found;
+        for_each_kill_pair([&](auto attacker_tag, auto prey_tag) {
+            using Attacker = typename decltype(attacker_tag)::type;
+            using Prey = typename decltype(prey_tag)::type;
+            scan_kill_pair<Attacker, Prey>(world, batches, 0, batches.of<Attacker>().size(),
+                                           [&](uint32_t a, uint32_t p) {
+                                               found.emplace_back(a, p);
+                                           });
+        });
+        return found;
+    };
+
+    const std::vector<SpawnShare> shares{{DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}};
+    size_t total = 0;
+    size_t left_out = 0;
+    for (uint32_t seed = 1; seed <= 20; ++seed) {
+        std::vector<NPCState> world;
+        factory(world, 400, shares, 400 + 40 * seed, 300, seed);
+        for (size_t i = 0; i < world.size(); i += 7)
+            world[i].alive = false;
+
+        RegionActivity regions;
+        regions.reset(400 + 40 * seed, 300);
+        regions.classify(world);
+        TypeBatches all;
+        all.rebuild(world);
+        TypeBatches active;
+        active.rebuild(world, [&](const NPCState& state) {
+            return regions.active(state.npc->x, state.npc->y);
+        });
+
+        const auto expected = candidates(world, all);
+        EXPECT_EQ(candidates(world, active), expected) << "seed " << seed;
+        for (size_t slot = 0; slot < kNpcSlots; ++slot)
+            left_out += all.indices[slot].size() - active.indices[slot].size();
+        total += expected.size();
+    }
+    EXPECT_GT(total, static_cast<size_t>(0));
+    EXPECT_GT(left_out, static_cast<size_t>(0));
+}
+
+TEST(Simulation, QuietRegionsMoveLessAndNeverFight) {
+    SimulationConfig config;
+    config.width = 600;
+    config.height = 600;
+    config.npcs = 200;
+    config.ticks = 20;
+    config.shares = {{PrincessType, 1.0}, {KnightType, 1.0}};
+    config.quiet_interval = 4;
+    Simulation start(config, 3);
+    Simulation simulation(config, 3);
+    simulation.run();
+
+    EXPECT_TRUE(simulation.kills().empty());
+    EXPECT_EQ(simulation.activity().active_regions(), static_cast<size_t>(0));
+    // Every NPC moved on 5 of the 20 ticks.
+    EXPECT_EQ(simulation.skipped_moves(), static_cast<size_t>(200 * 15));
+    size_t moved = 0;
+    for (size_t i = 0; i < simulation.npcs().size(); ++i)
+        if (simulation.npcs()[i].npc->x != start.npcs()[i].npc->x ||
+            simulation.npcs()[i].npc->y != start.npcs()[i].npc->y)
+            ++moved;
+    EXPECT_GT(moved, static_cast<size_t>(100));
+}
+
+TEST(Simulation, AdaptiveRunIsDeterministicAndConsistent) {
+    SimulationConfig config;
+    config.width = 1000;
+    config.height = 1000;
+    config.npcs = 400;
+    config.ticks = 30;
+    config.quiet_interval = 4;
+    Simulation a(config, 11);
+    Simulation b(config, 11);
+    a.run();
+    b.run();
+    EXPECT_GT(a.skipped_moves(), static_cast<size_t>(0));
+    EXPECT_EQ(a.skipped_moves(), b.skipped_moves());
+    EXPECT_EQ(a.survivors(), b.survivors());
+    ASSERT_EQ(a.kills().size(), b.kills().size());
+    for (const auto& kill : a.kills())
+        EXPECT_TRUE(can_kill(kill.attacker, kill.defender));
+    size_t alive = 0;
+    for (const auto& count : a.survivors())
+        alive += count;
+    EXPECT_EQ(alive + a.kills().size(), static_cast<size_t>(400));
+}
+
+TEST(Batch, AggregatesIndependentOfPoolSize) {
+    SimulationConfig config;
+    config.npcs = 60;
+    config.ticks = 20;
+    WorkerPool one(1);
+    WorkerPool three(3);
+    const auto a = run_batch(config, 25, 1000, one);
+    const auto b = run_batch(config, 25, 1000, three);
+    EXPECT_EQ(a.runs, static_cast<size_t>(25));
+    EXPECT_EQ(a.survivors, b.survivors);
+    EXPECT_EQ(a.kill_ticks, b.kill_ticks);
+
+    for_each_npc_type([&](auto tag) {
+        size_t runs = 0;
+        for (size_t count : a.survivors[decltype(tag)::type::kType])
+            runs += count;
+        EXPECT_EQ(runs, static_cast<size_t>(25));
+    });
+    size_t knight_deaths = 0;
+    for (size_t count : a.kill_ticks[KnightType])
+        knight_deaths += count;
+    EXPECT_EQ(knight_deaths, static_cast<size_t>(0));
+
+    std::stringstream out;
+    out << a;
+    EXPECT_NE(out.str().find("runs 25"), std::string::npos);
+    EXPECT_NE(out.str().find("survivors_histogram Princess"), std::string::npos);
+}
+
+TEST(VersionedBuffer, SnapshotsDoNotSeeLaterVersions) {
+    VersionedBuffer<int> buffer(10);
+    auto write_version = [&](int base) {
+        buffer.prepare();
+        for (size_t i = 0; i < 10; ++i)
+            buffer.next(i) = base + static_cast<int>(i);
+        buffer.publish();
+    };
+    write_version(0);
+    const auto first = buffer.snapshot();
+    write_version(100);
+    const auto second = buffer.snapshot();
+    write_version(200);
+
+    EXPECT_EQ(first.size(), static_cast<size_t>(10));
+    for (size_t i = 0; i < 10; ++i) {
+        EXPECT_EQ(first[i], static_cast<int>(i));
+        EXPECT_EQ(second[i], 100 + static_cast<int>(i));
+        EXPECT_EQ(buffer[i], 200 + static_cast<int>(i));
+    }
+    // The spare buffer covered the first pinned version; each further one
+    // costs an allocation in prepare().
+    EXPECT_EQ(buffer.allocations(), static_cast<size_t>(1));
+    buffer.prepare();
+    EXPECT_EQ(buffer.allocations(), static_cast<size_t>(2));
+}
+
+TEST(VersionedBuffer, ReusesBuffersWithoutSnapshots) {
+    VersionedBuffer<int> buffer(20);
+    for (int version = 0; version < 5; ++version) {
+        {
+            const auto dropped = buffer.snapshot();
+        }
+        buffer.prepare();
+        for (size_t i = 0; i < 20; ++i)
+            buffer.next(i) = version;
+        buffer.publish();
+    }
+    EXPECT_EQ(buffer[19], 4);
+    EXPECT_EQ(buffer.allocations(), static_cast<size_t>(0));
+}
+
+TEST(Checkpoint, RoundTripsSnapshotState) {
+    std::vector<NPCState> world;
+    world.push_back({factory(DragonType, "Smaug", 1, 2), true});
+    factory(world, 3, {{PrincessType, 1.0}}, 40, 20, 1);
+    auto positions = positions_of(world);
+
+    const auto snapshot = positions.snapshot();
+    // Later versions must not leak into the checkpoint.
+    world[0].npc->x = 30;
+    world[2].alive = false;
+    publish_positions(positions, world);
+
+    std::stringstream ss;
+    write_checkpoint(ss, world, snapshot);
+    const auto loaded = load_checkpoint(ss);
+    ASSERT_EQ(loaded.size(), static_cast<size_t>(4));
+    EXPECT_EQ(loaded[0].npc->type, DragonType);
+    EXPECT_EQ(loaded[0].npc->name, "Smaug");
+    EXPECT_EQ(loaded[0].npc->x, 1);
+    EXPECT_EQ(loaded[0].npc->y, 2);
+    EXPECT_EQ(loaded[2].npc->name, "Princess_2");
+    EXPECT_EQ(loaded[3].npc->x, world[3].npc->x);
+
+    std::stringstream later;
+    write_checkpoint(later, world, positions.snapshot());
+    EXPECT_EQ(load_checkpoint(later).size(), static_cast<size_t>(3));
+}
+
+namespace {
+const LockSiteStats* find_site(const LockProfile& profile, uint32_t line) {
+    const LockSiteStats* found = nullptr;
+    profile.for_each_site([&](const LockSiteStats& stats) {
+        if (stats.line == line)
+            found = &stats;
+    });
+    return found;
+}
+}
+
+TEST(LockProfiler, CountsPerCallSite) {
+    ProfiledMutex<std::mutex> mutex("test_mutex");
+    const uint32_t first_line = __LINE__ + 2;
+    for (int i = 0; i < 3; ++i) {
+        ProfiledLock lock(mutex);
+    }
+    const uint32_t second_line = __LINE__ + 1;
+    { ProfiledLock lock(mutex); }
+
+    const auto* first = find_site(mutex.profile, first_line);
+    const auto* second = find_site(mutex.profile, second_line);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(first->acquisitions.load(), 3u);
+    EXPECT_EQ(second->acquisitions.load(), 1u);
+    EXPECT_EQ(first->contended.load(), 0u);
+}
+
+TEST(LockProfiler, SiteCacheDoesNotOutliveProfiles) {
+    // Successive mutexes likely reuse the same stack slot; each must still
+    // record into its own table.
+    for (int round = 0; round < 3; ++round) {
+        ProfiledMutex<std::mutex> mutex("short_lived_mutex");
+        const uint32_t line = __LINE__ + 1;
+        { ProfiledLock lock(mutex); }
+        { ProfiledLock lock(mutex); }
+        size_t sites = 0;
+        mutex.profile.for_each_site([&](const LockSiteStats& stats) {
+            ++sites;
+            EXPECT_NE(stats.file, nullptr);
+        });
+        EXPECT_EQ(sites, static_cast<size_t>(2));
+        const auto* first = find_site(mutex.profile, line);
+        ASSERT_TRUE(first);
+        EXPECT_EQ(first->acquisitions.load(), 1u);
+    }
+}
+
+TEST(LockProfiler, MeasuresWaitAndHoldUnderContention) {
+    ProfiledMutex<std::shared_mutex> mutex("test_shared_mutex");
+    std::atomic<bool> held{false};
+    const uint32_t writer_line = __LINE__ + 2;
+    std::thread writer([&]() {
+        ProfiledLock lock(mutex);
+        held = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    });
+    while (!held.load())
+        std::this_thread::yield();
+    const uint32_t reader_line = __LINE__ + 2;
+    {
+        ProfiledSharedLock lock(mutex);
+    }
+    writer.join();
+
+    const auto* writer_site = find_site(mutex.profile, writer_line);
+    const auto* reader_site = find_site(mutex.profile, reader_line);
+    ASSERT_TRUE(writer_site);
+    ASSERT_TRUE(reader_site);
+    EXPECT_GE(writer_site->max_hold_ns.load(), 25'000'000u);
+    EXPECT_EQ(reader_site->contended.load(), 1u);
+    EXPECT_GE(reader_site->max_wait_ns.load(), 10'000'000u);
+    EXPECT_GE(reader_site->wait_percentile_ns(0.5), 10'000'000u);
+
+    std::stringstream report;
+    mutex.profile.report(report);
+    EXPECT_NE(report.str().find("test_shared_mutex"), std::string::npos);
+    EXPECT_NE(report.str().find("contended 1"), std::string::npos);
+}
+
+TEST(LockProfiler, WorksWithConditionVariableAny) {
+    ProfiledMutex<std::mutex> mutex("cv_mutex");
+    std::condition_variable_any cv;
+    bool ready = false;
+    std::thread producer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        {
+            ProfiledLock lock(mutex);
+            ready = true;
+        }
+        cv.notify_all();
+    });
+    {
+        ProfiledLock lock(mutex);
+        cv.wait(lock, [&]() { return ready; });
+        EXPECT_TRUE(ready);
+    }
+    producer.join();
+
+    std::stringstream report;
+    LockProfile::report_all(report);
+    EXPECT_NE(report.str().find("cv_mutex"), std::string::npos);
+    EXPECT_NE(report.str().find("console_mutex"), std::string::npos);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "npc_registry.hpp"
+#include "simulation.hpp"
+#include "worker_pool.hpp"
+
+// Aggregate of many independent runs. Histograms are indexed by NpcType:
+// survivors[type][n] counts runs that ended with n survivors of `type`,
+// kill_ticks[type][t] counts `type` deaths in tick t over all runs.
+struct BatchSummary {
+    size_t runs{0};
+    size_t ticks{0};
+    double seconds{0.0};
+    std::array<std::vector<size_t>, kNpcSlots> survivors;
+    std::array<std::vector<size_t>, kNpcSlots> kill_ticks;
+
+    void add(const Simulation& simulation) {
+        ++runs;
+        const auto counts = simulation.survivors();
+        for (size_t type = 0; type < kNpcSlots; ++type) {
+            auto& histogram = survivors[type];
+            if (histogram.size() <= counts[type])
+                histogram.resize(counts[type] + 1);
+            ++histogram[counts[type]];
+        }
+        for (const auto& kill : simulation.kills()) {
+            auto& histogram = kill_ticks[type_slot(kill.defender)];
+            if (histogram.size() <= kill.tick)
+                histogram.resize(kill.tick + 1);
+            ++histogram[kill.tick];
+        }
+    }
+
+    void merge(const BatchSummary& other) {
+        runs += other.runs;
+        auto add_histogram = [](std::vector<size_t>& into, const std::vector<size_t>& from) {
+            if (into.size() < from.size())
+                into.resize(from.size());
+            for (size_t i = 0; i < from.size(); ++i)
+                into[i] += from[i];
+        };
+        for (size_t type = 0; type < kNpcSlots; ++type) {
+            add_histogram(survivors[type], other.survivors[type]);
+            add_histogram(kill_ticks[type], other.kill_ticks[type]);
+        }
+    }
+
+    double mean_survivors(NpcType type) const {
+        const auto& histogram = survivors[type_slot(type)];
+        size_t total = 0;
+        for (size_t n = 0; n < histogram.size(); ++n)
+            total += n * histogram[n];
+        return runs ? static_cast<double>(total) / static_cast<double>(runs) : 0.0;
+    }
+
+    double runs_per_second() const {
+        return seconds > 0.0 ? static_cast<double>(runs) / seconds : 0.0;
+    }
+};
+
+// Runs `runs` worlds seeded seed, seed + 1, ... across the pool. Each worker
+// keeps its own partial summary, merged once at the end, so runs never
+// contend on shared state and the result does not depend on the pool size.
+inline BatchSummary run_batch(const SimulationConfig& config, size_t runs, uint32_t seed,
+                              WorkerPool& pool) {
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<BatchSummary> partial(pool.threads());
+    pool.run(runs, [&](size_t first, size_t last, unsigned worker) {
+        for (size_t r = first; r < last; ++r) {
+            Simulation simulation(config, seed + static_cast<uint32_t>(r));
+            simulation.run();
+            partial[worker].add(simulation);
+        }
+    });
+
+    BatchSummary summary;
+    for (const auto& part : partial)
+        summary.merge(part);
+    summary.ticks = config.ticks;
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return summary;
+}
+
+inline std::ostream& operator<<(std::ostream& os, const BatchSummary& summary) {
+    os << "runs " << summary.runs << std::endl;
+    os << "ticks " << summary.ticks << std::endl;
+    os << "seconds " << summary.seconds << std::endl;
+    os << "runs_per_second " << summary.runs_per_second() << std::endl;
+    for_each_npc_type([&](auto tag) {
+        const NpcType type = decltype(tag)::type::kType;
+        const char* label = type_label(type);
+        os << "survivors_mean " << label << " " << summary.mean_survivors(type) << std::endl;
+        os << "survivors_histogram " << label;
+        const auto& survivors = summary.survivors[type];
+        for (size_t n = 0; n < survivors.size(); ++n)
+            if (survivors[n])
+                os << " " << n << ":" << survivors[n];
+        os << std::endl;
+        os << "kill_tick_histogram " << label;
+        const auto& kills = summary.kill_ticks[type];
+        for (size_t t = 0; t < kills.size(); ++t)
+            if (kills[t])
+                os << " " << t << ":" << kills[t];
+        os << std::endl;
+    });
+    return os;
+}
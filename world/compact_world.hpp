@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "factory.hpp"
+
+// Heap bytes one NPC costs in the object representation. Sizes of library
+// internals are estimates: make_shared puts the object next to two reference
+// counters and a vtable pointer, std::string keeps short names inline.
+struct NpcMemory {
+    size_t slot{0};           // NPCState in the world vector
+    size_t object{0};         // Dragon/Princess/Knight itself
+    size_t control_block{0};  // shared_ptr counters sharing the allocation
+    size_t name_heap{0};      // name characters that did not fit inline
+    size_t observers_heap{0}; // observer vector buffer
+
+    size_t total() const {
+        return slot + object + control_block + name_heap + observers_heap;
+    }
+};
+
+inline size_t object_size(NpcType type) {
+    size_t size = sizeof(NPC);
+    dispatch_type(type, [&](auto tag) { size = sizeof(typename decltype(tag)::type); });
+    return size;
+}
+
+inline NpcMemory npc_memory(const NPC& npc) {
+    constexpr size_t kInlineName = std::string().capacity();
+    NpcMemory memory;
+    memory.slot = sizeof(NPCState);
+    memory.object = object_size(npc.type);
+    memory.control_block = 2 * sizeof(int) + sizeof(void*);
+    if (npc.name.capacity() > kInlineName)
+        memory.name_heap = npc.name.capacity() + 1;
+    memory.observers_heap =
+        npc.observers.capacity() * sizeof(std::shared_ptr<IFightObserver>);
+    return memory;
+}
+
+struct MemoryReport {
+    size_t npcs{0};
+    NpcMemory bytes;
+
+    double bytes_per_npc() const {
+        return npcs ? static_cast<double>(bytes.total()) / static_cast<double>(npcs) : 0.0;
+    }
+};
+
+inline MemoryReport memory_report(const std::vector<NPCState>& world) {
+    MemoryReport report;
+    for (const auto& state : world) {
+        if (!state.npc)
+            continue;
+        const auto memory = npc_memory(*state.npc);
+        ++report.npcs;
+        report.bytes.slot += memory.slot;
+        report.bytes.object += memory.object;
+        report.bytes.control_block += memory.control_block;
+        report.bytes.name_heap += memory.name_heap;
+        report.bytes.observers_heap += memory.observers_heap;
+    }
+    // Spare capacity of the world vector is paid for as well.
+    report.bytes.slot += (world.capacity() - world.size()) * sizeof(NPCState);
+    return report;
+}
+
+inline std::ostream& operator<<(std::ostream& os, const MemoryReport& report) {
+    os << report.npcs << " NPCs, " << report.bytes.total() << " bytes ("
+       << report.bytes_per_npc() << " per NPC: slot " << sizeof(NPCState)
+       << ", objects " << report.bytes.object
+       << ", control blocks " << report.bytes.control_block
+       << ", names " << report.bytes.name_heap
+       << ", observers " << report.bytes.observers_heap << ")";
+    return os;
+}
+
+// Compact world: parallel arrays with Coord coordinates, a 1-byte type and
+// a 32-bit name id per NPC, ~9 bytes each with 16-bit coordinates instead of
+// well over a hundred. NPCs are identified by their index. A name id equal to
+// the index means the generated "<Type>_<index>" name; ids with kCustomName
+// set point into `names`.
+//
+// This is a storage layout only: nothing moves or fights in it yet, and code
+// that needs the object API goes through expand().
+template <typename Coord>
+class BasicCompactWorld {
+public:
+    using coord_t = Coord;
+    static constexpr uint32_t kCustomName = 0x80000000u;
+
+    std::vector<coord_t> x;
+    std::vector<coord_t> y;
+    std::vector<uint8_t> type;
+    std::vector<uint32_t> name_id;
+    std::vector<bool> alive;
+    std::vector<std::string> names;
+
+    // coord_t must cover every cell (65536 per side for 16 bits), and
+    // indices must leave the kCustomName bit free.
+    static bool fits(int width, int height, size_t count) {
+        constexpr long long kMaxSide =
+            static_cast<long long>(std::numeric_limits<coord_t>::max()) + 1;
+        return width > 0 && height > 0 && width <= kMaxSide && height <= kMaxSide &&
+               count < kCustomName;
+    }
+
+    size_t size() const { return type.size(); }
+
+    void reserve(size_t count) {
+        x.reserve(count);
+        y.reserve(count);
+        type.reserve(count);
+        name_id.reserve(count);
+        alive.reserve(count);
+    }
+
+    void resize(size_t count) {
+        x.resize(count);
+        y.resize(count);
+        type.resize(count);
+        name_id.resize(count);
+        alive.resize(count, true);
+    }
+
+    // An empty name stands for the generated one.
+    void push_back(NpcType t, const std::string& name, int px, int py) {
+        const auto index = static_cast<uint32_t>(size());
+        x.push_back(static_cast<coord_t>(px));
+        y.push_back(static_cast<coord_t>(py));
+        type.push_back(static_cast<uint8_t>(t));
+        name_id.push_back(name.empty() ? index : kCustomName | intern(name));
+        alive.push_back(true);
+    }
+
+    uint32_t intern(const std::string& name) {
+        names.push_back(name);
+        return static_cast<uint32_t>(names.size() - 1);
+    }
+
+    NpcType type_of(size_t i) const { return static_cast<NpcType>(type[i]); }
+
+    std::string name_of(size_t i) const {
+        if (name_id[i] & kCustomName)
+            return names[name_id[i] & ~kCustomName];
+        return std::string(type_label(type_of(i))) + "_" + std::to_string(name_id[i]);
+    }
+
+    // Builds a full NPC (with observers) for code that needs the object API.
+    std::shared_ptr<NPC> expand(size_t i) const {
+        auto npc = factory(type_of(i), std::string(), x[i], y[i]);
+        if (!npc)
+            return npc;
+        if (name_id[i] & kCustomName)
+            npc->name = names[name_id[i] & ~kCustomName];
+        else
+            npc->id = name_id[i];
+        return npc;
+    }
+
+    size_t memory_bytes() const {
+        size_t names_bytes = names.capacity() * sizeof(std::string);
+        for (const auto& name : names)
+            if (name.capacity() > std::string().capacity())
+                names_bytes += name.capacity() + 1;
+        return x.capacity() * sizeof(coord_t) + y.capacity() * sizeof(coord_t) +
+               type.capacity() + name_id.capacity() * sizeof(uint32_t) +
+               alive.capacity() / 8 + names_bytes;
+    }
+
+    double bytes_per_npc() const {
+        return size() ? static_cast<double>(memory_bytes()) / static_cast<double>(size()) : 0.0;
+    }
+};
+
+using CompactWorld = BasicCompactWorld<uint16_t>;
+// Fallback for maps wider or taller than 65536 cells.
+using WideCompactWorld = BasicCompactWorld<uint32_t>;
+
+// Compact counterpart of the bulk factory: same seed, same NPCs.
+template <typename Coord>
+bool compact_factory(BasicCompactWorld<Coord>& world, size_t count,
+                     const std::vector<SpawnShare>& shares, int width, int height,
+                     uint32_t seed, unsigned threads = 0) {
+    const size_t base = world.size();
+    if (!BasicCompactWorld<Coord>::fits(width, height, base + count))
+        return false;
+    world.resize(base + count);
+    auto no_state = []() { return 0; };
+    auto emit = [&](int, size_t i, NpcType type, int x, int y) {
+        const size_t index = base + i;
+        world.x[index] = static_cast<Coord>(x);
+        world.y[index] = static_cast<Coord>(y);
+        world.type[index] = static_cast<uint8_t>(type);
+        world.name_id[index] = static_cast<uint32_t>(index);
+    };
+    if (!spawn_chunks(count, shares, width, height, seed, threads, no_state, emit)) {
+        world.resize(base);
+        return false;
+    }
+    return true;
+}
+
+template <typename Coord>
+bool compact_from(BasicCompactWorld<Coord>& compact, const std::vector<NPCState>& world,
+                  int width, int height) {
+    if (!BasicCompactWorld<Coord>::fits(width, height, compact.size() + world.size()))
+        return false;
+    compact.reserve(compact.size() + world.size());
+    for (const auto& state : world) {
+        const auto& npc = state.npc;
+        compact.push_back(npc->type, npc->name, npc->x, npc->y);
+        if (npc->id != NPC::kNoId)
+            compact.name_id.back() = static_cast<uint32_t>(npc->id);
+        else if (npc->name.empty())
+            compact.name_id.back() =
+                BasicCompactWorld<Coord>::kCustomName | compact.intern(npc->name);
+        compact.alive.back() = state.alive;
+    }
+    return true;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../objects/npc/npc.hpp"
+#include "../objects/dragon/dragon.hpp"
+#include "../objects/princess/princess.hpp"
+#include "../objects/knight/knight.hpp"
+#include "npc_registry.hpp"
+#include "lock_profiler.hpp"
+
+namespace detail {
+inline ProfiledMutex<std::mutex> console_mutex{"console_mutex"};
+}
+
+class TextObserver : public IFightObserver {
+private:
+    TextObserver() = default;
+
+public:
+    static std::shared_ptr<IFightObserver> get() {
+        static TextObserver instance;
+        return std::shared_ptr<IFightObserver>(&instance, [](IFightObserver*) {});
+    }
+
+    void on_fight(const std::shared_ptr<NPC> attacker,
+                  const std::shared_ptr<NPC> defender, bool win) override {
+        if (!win)
+            return;
+        ProfiledLock lock(detail::console_mutex);
+        std::cout << std::endl << "Murder --------" << std::endl;
+        attacker->print(std::cout);
+        defender->print(std::cout);
+    }
+};
+
+class FileObserver : public IFightObserver {
+private:
+    std::ofstream fs;
+    FileObserver() { fs.open("log.txt"); }
+
+public:
+    ~FileObserver() { fs.close(); }
+    static std::shared_ptr<IFightObserver> get() {
+        static FileObserver instance;
+        return std::shared_ptr<IFightObserver>(&instance, [](IFightObserver*) {});
+    }
+
+    void on_fight(const std::shared_ptr<NPC> attacker,
+                  const std::shared_ptr<NPC> defender, bool win) override {
+        if (!win)
+            return;
+        fs << std::endl << "Murder --------" << std::endl;
+        attacker->print(fs);
+        defender->print(fs);
+    }
+};
+
+struct NPCState {
+    std::shared_ptr<NPC> npc;
+    bool alive{true};
+};
+
+inline std::shared_ptr<NPC> factory(NpcType type, const std::string& name, int x, int y) {
+    auto result = make_npc(type, name, x, y);
+    if (result) {
+        result->subscribe(TextObserver::get());
+        result->subscribe(FileObserver::get());
+    }
+    return result;
+}
+
+struct SpawnShare {
+    NpcType type;
+    double weight;
+};
+
+// NPCs are generated in fixed-size chunks, each with its own RNG seeded from
+// (seed, chunk index), so the world does not depend on the thread count.
+constexpr size_t kSpawnChunk = 1 << 16;
+
+// Draws `count` (type, x, y) triples by the weights in `shares` and calls
+// `emit(index, type, x, y)` for each from `threads` workers. `emit` runs
+// concurrently for different indices. `make_worker_state` is called once per
+// worker and its result passed to `emit` as the first argument. Returns false
+// if `shares` holds no usable type.
+template <typename MakeState, typename Emit>
+bool spawn_chunks(size_t count, const std::vector<SpawnShare>& shares,
+                  int width, int height, uint32_t seed, unsigned threads,
+                  MakeState make_worker_state, Emit emit) {
+    std::vector<NpcType> types;
+    std::vector<double> weights;
+    for (const auto& share : shares) {
+        if (!is_npc_type(share.type) || share.weight <= 0.0)
+            continue;
+        types.push_back(share.type);
+        weights.push_back(share.weight);
+    }
+    if (types.empty())
+        return false;
+    if (count == 0)
+        return true;
+
+    const size_t chunks = (count + kSpawnChunk - 1) / kSpawnChunk;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, chunks));
+
+    std::atomic<size_t> next_chunk{0};
+    auto worker = [&]() {
+        auto state = make_worker_state();
+        for (size_t chunk = next_chunk++; chunk < chunks; chunk = next_chunk++) {
+            std::seed_seq seq{seed, static_cast<uint32_t>(chunk)};
+            std::mt19937 rng(seq);
+            std::discrete_distribution<size_t> type_dist(weights.begin(), weights.end());
+            std::uniform_int_distribution<int> x_dist(0, width - 1);
+            std::uniform_int_distribution<int> y_dist(0, height - 1);
+            const size_t begin = chunk * kSpawnChunk;
+            const size_t end = std::min(count, begin + kSpawnChunk);
+            for (size_t i = begin; i < end; ++i) {
+                const NpcType type = types[type_dist(rng)];
+                const int x = x_dist(rng);
+                const int y = y_dist(rng);
+                emit(state, i, type, x, y);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool)
+        thread.join();
+    return true;
+}
+
+// Bulk factory: appends `count` NPCs to `world`, picking types by the weights
+// in `shares` and positions uniformly inside width x height. The storage is
+// sized once and then filled in parallel; each NPC's id is its index in
+// `world` and stands in for the name. Shares of unknown types are ignored.
+inline void factory(std::vector<NPCState>& world, size_t count,
+                    const std::vector<SpawnShare>& shares, int width, int height,
+                    uint32_t seed, unsigned threads = 0) {
+    const size_t base = world.size();
+    world.resize(base + count);
+
+    struct Observers {
+        std::shared_ptr<IFightObserver> text;
+        std::shared_ptr<IFightObserver> file;
+    };
+    // Own observer handles per worker: the shared_ptrs returned by get()
+    // each carry a separate control block, so workers never bump the same
+    // reference counter.
+    auto make_observers = []() {
+        return Observers{TextObserver::get(), FileObserver::get()};
+    };
+    auto emit = [&](const Observers& observers, size_t i, NpcType type, int x, int y) {
+        auto npc = make_npc(type, std::string(), x, y);
+        npc->id = base + i;
+        npc->observers.reserve(2);
+        npc->subscribe(observers.text);
+        npc->subscribe(observers.file);
+        world[base + i].npc = std::move(npc);
+    };
+    if (!spawn_chunks(count, shares, width, height, seed, threads, make_observers, emit))
+        world.resize(base);
+}
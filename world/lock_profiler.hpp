@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <source_location>
+#include <vector>
+
+// Lock contention profiling. ProfiledMutex wraps a standard mutex and counts,
+// per call site, how often it was taken, how long callers waited for it and
+// how long they held it. Sites are captured by the ProfiledLock and
+// ProfiledSharedLock guards through a defaulted std::source_location, so a
+// guard declaration is all a call site needs. A per-thread cache maps the
+// call site to its stats slot, so the hot path is one compare, a try_lock,
+// two clock reads and a handful of relaxed atomic adds.
+
+struct LockSiteStats {
+    static constexpr size_t kBuckets = 40;  // log2(ns) wait-time histogram
+
+    std::atomic<uint64_t> key{0};
+    const char* file{nullptr};
+    const char* function{nullptr};
+    uint32_t line{0};
+
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contended{0};
+    std::atomic<uint64_t> wait_ns{0};
+    std::atomic<uint64_t> max_wait_ns{0};
+    std::atomic<uint64_t> hold_ns{0};
+    std::atomic<uint64_t> max_hold_ns{0};
+    std::array<std::atomic<uint64_t>, kBuckets> wait_histogram{};
+
+    static size_t bucket(uint64_t ns) {
+        size_t b = 0;
+        while (ns > 1 && b + 1 < kBuckets) {
+            ns >>= 1;
+            ++b;
+        }
+        return b;
+    }
+
+    static void raise_max(std::atomic<uint64_t>& max, uint64_t value) {
+        uint64_t current = max.load(std::memory_order_relaxed);
+        while (value > current &&
+               !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    void record_acquire(uint64_t waited_ns, bool was_contended) {
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (!was_contended)
+            return;
+        contended.fetch_add(1, std::memory_order_relaxed);
+        wait_ns.fetch_add(waited_ns, std::memory_order_relaxed);
+        raise_max(max_wait_ns, waited_ns);
+        wait_histogram[bucket(waited_ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void record_release(uint64_t held_ns) {
+        hold_ns.fetch_add(held_ns, std::memory_order_relaxed);
+        raise_max(max_hold_ns, held_ns);
+    }
+
+    // Wait time below which `fraction` of contended acquisitions fell: the
+    // upper edge of the histogram bucket, capped by the largest wait seen.
+    uint64_t wait_percentile_ns(double fraction) const {
+        const uint64_t total = contended.load(std::memory_order_relaxed);
+        if (total == 0)
+            return 0;
+        const auto target = static_cast<uint64_t>(fraction * static_cast<double>(total));
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kBuckets; ++b) {
+            seen += wait_histogram[b].load(std::memory_order_relaxed);
+            if (seen > target)
+                return std::min(uint64_t{2} << b, max_wait_ns.load(std::memory_order_relaxed));
+        }
+        return max_wait_ns.load(std::memory_order_relaxed);
+    }
+};
+
+class LockProfile {
+public:
+    static constexpr size_t kSites = 64;
+
+    explicit LockProfile(const char* name) : name(name), serial(next_serial()) {
+        registry().add(this);
+    }
+    ~LockProfile() { registry().remove(this); }
+
+    LockProfile(const LockProfile&) = delete;
+    LockProfile& operator=(const LockProfile&) = delete;
+
+    // Stats slot for a call site: an open-addressed table keyed by the
+    // (static) file name pointer and line. The last slot collects sites that
+    // no longer fit.
+    LockSiteStats& site(const std::source_location& where) {
+        const uint64_t key = (reinterpret_cast<uintptr_t>(where.file_name()) << 16) ^
+                             where.line() ^ 1;
+        size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 58) % (kSites - 1);
+        for (size_t probe = 0; probe < kSites - 1; ++probe, slot = (slot + 1) % (kSites - 1)) {
+            auto& stats = sites[slot];
+            uint64_t current = stats.key.load(std::memory_order_acquire);
+            if (current == key)
+                return stats;
+            if (current == 0 &&
+                stats.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                stats.file = where.file_name();
+                stats.function = where.function_name();
+                stats.line = where.line();
+                return stats;
+            }
+            if (current == key)
+                return stats;
+        }
+        return sites[kSites - 1];
+    }
+
+    // site() behind a small per-thread direct-mapped cache. Entries are keyed
+    // by the profile's serial rather than its address, so a profile created
+    // where a destroyed one lived never hits a stale entry.
+    LockSiteStats& cached_site(const std::source_location& where) {
+        struct Entry {
+            uint64_t serial{0};
+            const char* file{nullptr};
+            uint_least32_t line{0};
+            LockSiteStats* stats{nullptr};
+        };
+        thread_local std::array<Entry, 16> cache{};
+        auto& entry = cache[where.line() % cache.size()];
+        if (entry.serial == serial && entry.line == where.line() &&
+            entry.file == where.file_name())
+            return *entry.stats;
+        auto& stats = site(where);
+        entry = {serial, where.file_name(), where.line(), &stats};
+        return stats;
+    }
+
+    // Calls fn(stats) for every site that took the lock at least once.
+    template <typename Fn>
+    void for_each_site(Fn fn) const {
+        for (const auto& stats : sites)
+            if (stats.acquisitions.load(std::memory_order_relaxed) > 0)
+                fn(stats);
+    }
+
+    void report(std::ostream& os) const {
+        const auto precision = os.precision();
+        os << name << ":" << std::endl;
+        for_each_site([&](const LockSiteStats& stats) {
+            const uint64_t count = stats.acquisitions.load(std::memory_order_relaxed);
+            const uint64_t contended = stats.contended.load(std::memory_order_relaxed);
+            os << "  " << (stats.file ? stats.file : "<other sites>") << ":" << stats.line
+               << "  acquired " << count << ", contended " << contended << " ("
+               << std::fixed << std::setprecision(1)
+               << 100.0 * static_cast<double>(contended) / static_cast<double>(count)
+               << "%), wait total " << ms(stats.wait_ns) << " ms, max "
+               << us(stats.max_wait_ns) << " us, p50 "
+               << us_value(stats.wait_percentile_ns(0.5)) << " us, p99 "
+               << us_value(stats.wait_percentile_ns(0.99)) << " us, hold total "
+               << ms(stats.hold_ns) << " ms, max " << us(stats.max_hold_ns) << " us"
+               << std::defaultfloat << std::setprecision(static_cast<int>(precision))
+               << std::endl;
+        });
+    }
+
+    // Every live profile, for the report at exit.
+    static void report_all(std::ostream& os) {
+        auto& all = registry();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        os << "Lock contention report" << std::endl;
+        for (const auto* profile : all.profiles)
+            profile->report(os);
+    }
+
+    const char* const name;
+
+private:
+    struct Registry {
+        std::mutex mutex;
+        std::vector<const LockProfile*> profiles;
+
+        void add(const LockProfile* profile) {
+            std::lock_guard<std::mutex> lock(mutex);
+            profiles.push_back(profile);
+        }
+        void remove(const LockProfile* profile) {
+            std::lock_guard<std::mutex> lock(mutex);
+            profiles.erase(std::remove(profiles.begin(), profiles.end(), profile), profiles.end());
+        }
+    };
+
+    static uint64_t next_serial() {
+        static std::atomic<uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    static double us_value(uint64_t ns) { return static_cast<double>(ns) / 1e3; }
+    static double us(const std::atomic<uint64_t>& ns) { return us_value(ns.load()); }
+    static double ms(const std::atomic<uint64_t>& ns) { return static_cast<double>(ns.load()) / 1e6; }
+
+    const uint64_t serial;
+    std::array<LockSiteStats, kSites> sites{};
+};
+
+template <typename Mutex>
+class ProfiledMutex {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit ProfiledMutex(const char* name) : profile(name) {}
+
+    clock::time_point acquire(LockSiteStats& site) {
+        if (mutex.try_lock()) {
+            site.record_acquire(0, false);
+            return clock::now();
+        }
+        const auto begin = clock::now();
+        mutex.lock();
+        const auto acquired = clock::now();
+        site.record_acquire(nanoseconds(acquired - begin), true);
+        return acquired;
+    }
+
+    void release(LockSiteStats& site, clock::time_point acquired) {
+        const auto held = nanoseconds(clock::now() - acquired);
+        mutex.unlock();
+        site.record_release(held);
+    }
+
+    clock::time_point acquire_shared(LockSiteStats& site) {
+        if (mutex.try_lock_shared()) {
+            site.record_acquire(0, false);
+            return clock::now();
+        }
+        const auto begin = clock::now();
+        mutex.lock_shared();
+        const auto acquired = clock::now();
+        site.record_acquire(nanoseconds(acquired - begin), true);
+        return acquired;
+    }
+
+    void release_shared(LockSiteStats& site, clock::time_point acquired) {
+        const auto held = nanoseconds(clock::now() - acquired);
+        mutex.unlock_shared();
+        site.record_release(held);
+    }
+
+    LockProfile profile;
+
+private:
+    static uint64_t nanoseconds(clock::duration d) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+
+    Mutex mutex;
+};
+
+// Exclusive guard; also BasicLockable, so std::condition_variable_any can
+// release and retake it while waiting (retakes count against the same site).
+template <typename Mutex>
+class ProfiledLock {
+public:
+    explicit ProfiledLock(ProfiledMutex<Mutex>& mutex,
+                          std::source_location where = std::source_location::current())
+        : mutex(mutex), site(mutex.profile.cached_site(where)) {
+        lock();
+    }
+
+    ~ProfiledLock() {
+        if (owns)
+            unlock();
+    }
+
+    ProfiledLock(const ProfiledLock&) = delete;
+    ProfiledLock& operator=(const ProfiledLock&) = delete;
+
+    void lock() {
+        acquired = mutex.acquire(site);
+        owns = true;
+    }
+
+    void unlock() {
+        owns = false;
+        mutex.release(site, acquired);
+    }
+
+private:
+    ProfiledMutex<Mutex>& mutex;
+    LockSiteStats& site;
+    typename ProfiledMutex<Mutex>::clock::time_point acquired;
+    bool owns{false};
+};
+
+template <typename Mutex>
+class ProfiledSharedLock {
+public:
+    explicit ProfiledSharedLock(ProfiledMutex<Mutex>& mutex,
+                                std::source_location where = std::source_location::current())
+        : mutex(mutex), site(mutex.profile.cached_site(where)),
+          acquired(mutex.acquire_shared(site)) {}
+
+    ~ProfiledSharedLock() { mutex.release_shared(site, acquired); }
+
+    ProfiledSharedLock(const ProfiledSharedLock&) = delete;
+    ProfiledSharedLock& operator=(const ProfiledSharedLock&) = delete;
+
+private:
+    ProfiledMutex<Mutex>& mutex;
+    LockSiteStats& site;
+    typename ProfiledMutex<Mutex>::clock::time_point acquired;
+};
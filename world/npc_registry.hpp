@@ -0,0 +1,192 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "../objects/npc/npc.hpp"
+#include "../objects/dragon/dragon.hpp"
+#include "../objects/princess/princess.hpp"
+#include "../objects/knight/knight.hpp"
+
+// Per-type tables generated from NpcTypes and the traits each NPC class
+// declares, so adding a type does not mean editing a switch per table.
+
+template <typename... Ts, typename F>
+constexpr void for_each_type(TypeList<Ts...>, F&& f) {
+    (f(std::type_identity<Ts>{}), ...);
+}
+
+// Calls f(std::type_identity<T>{}) for every NPC type.
+template <typename F>
+constexpr void for_each_npc_type(F&& f) {
+    for_each_type(NpcTypes{}, f);
+}
+
+// Calls f(std::type_identity<Attacker>{}, std::type_identity<Prey>{}) for
+// every pair where Attacker kills Prey.
+template <typename F>
+constexpr void for_each_kill_pair(F&& f) {
+    for_each_npc_type([&](auto attacker) {
+        using A = typename decltype(attacker)::type;
+        for_each_npc_type([&](auto prey) {
+            using P = typename decltype(prey)::type;
+            if constexpr (A::template kills<P>)
+                f(attacker, prey);
+        });
+    });
+}
+
+// Calls f(std::type_identity<T>{}) for the type whose kType is `type`.
+// Returns false for Unknown and anything not in NpcTypes.
+template <typename F>
+bool dispatch_type(NpcType type, F&& f) {
+    bool found = false;
+    for_each_npc_type([&](auto tag) {
+        if (!found && decltype(tag)::type::kType == type) {
+            found = true;
+            f(tag);
+        }
+    });
+    return found;
+}
+
+template <typename... Ts>
+constexpr size_t type_count(TypeList<Ts...>) {
+    return sizeof...(Ts);
+}
+
+// Slot 0 is Unknown; type T lives in slot T::kType.
+constexpr size_t kNpcSlots = type_count(NpcTypes{}) + 1;
+
+constexpr bool npc_types_are_dense() {
+    size_t slot = 1;
+    bool dense = true;
+    for_each_npc_type([&](auto tag) {
+        dense = dense && static_cast<size_t>(decltype(tag)::type::kType) == slot++;
+    });
+    return dense;
+}
+static_assert(npc_types_are_dense(), "NpcTypes must list types in NpcType order from 1");
+
+struct MovementAttributes {
+    double step;
+    size_t kill_distance;
+};
+
+struct NpcTraits {
+    const char* label;
+    char symbol;
+    MovementAttributes movement;
+};
+
+constexpr std::array<NpcTraits, kNpcSlots> kNpcTraits = [] {
+    std::array<NpcTraits, kNpcSlots> table{};
+    table[Unknown] = {"Unknown", '?', {0.0, 0}};
+    for_each_npc_type([&](auto tag) {
+        using T = typename decltype(tag)::type;
+        table[T::kType] = {T::kLabel, T::kSymbol, {T::kStep, T::kKillDistance}};
+    });
+    return table;
+}();
+
+constexpr std::array<std::array<bool, kNpcSlots>, kNpcSlots> kKillTable = [] {
+    std::array<std::array<bool, kNpcSlots>, kNpcSlots> table{};
+    for_each_kill_pair([&](auto attacker, auto prey) {
+        table[decltype(attacker)::type::kType][decltype(prey)::type::kType] = true;
+    });
+    return table;
+}();
+
+constexpr bool is_npc_type(NpcType type) {
+    return type > Unknown && static_cast<size_t>(type) < kNpcSlots;
+}
+
+constexpr size_t type_slot(NpcType type) {
+    return is_npc_type(type) ? static_cast<size_t>(type) : 0;
+}
+
+constexpr const char* type_label(NpcType type) {
+    return kNpcTraits[type_slot(type)].label;
+}
+
+constexpr char symbol_for_type(NpcType type) {
+    return kNpcTraits[type_slot(type)].symbol;
+}
+
+constexpr MovementAttributes get_attributes(NpcType type) {
+    return kNpcTraits[type_slot(type)].movement;
+}
+
+constexpr bool can_kill(NpcType attacker, NpcType defender) {
+    return kKillTable[type_slot(attacker)][type_slot(defender)];
+}
+
+inline std::shared_ptr<NPC> make_npc(NpcType type, const std::string& name, int x, int y) {
+    std::shared_ptr<NPC> result;
+    dispatch_type(type, [&](auto tag) {
+        result = std::make_shared<typename decltype(tag)::type>(name, x, y);
+    });
+    return result;
+}
+
+// Typed, non-owning handle for std::visit-based dispatch in hot loops.
+template <typename List>
+struct NpcPointerVariant;
+
+template <typename... Ts>
+struct NpcPointerVariant<TypeList<Ts...>> {
+    using type = std::variant<Ts*...>;
+};
+
+using NpcRef = NpcPointerVariant<NpcTypes>::type;
+
+inline NpcRef npc_ref(NPC& npc) {
+    NpcRef ref;
+    dispatch_type(npc.type, [&](auto tag) {
+        ref = static_cast<typename decltype(tag)::type*>(&npc);
+    });
+    return ref;
+}
+
+template <typename Attacker, typename Defender>
+constexpr bool kills_v = Attacker::template kills<Defender>;
+
+inline bool can_kill(const NpcRef& attacker, const NpcRef& defender) {
+    return std::visit(
+        [](auto* a, auto* d) {
+            return kills_v<std::remove_pointer_t<decltype(a)>, std::remove_pointer_t<decltype(d)>>;
+        },
+        attacker, defender);
+}
+
+// Indices of live NPCs grouped by type, so a loop can run over one type at
+// a time with its traits known at compile time.
+struct TypeBatches {
+    std::array<std::vector<uint32_t>, kNpcSlots> indices;
+
+    template <typename World>
+    void rebuild(const World& world) {
+        rebuild(world, [](const auto&) { return true; });
+    }
+
+    // Only the live NPCs for which keep(world[i]) holds.
+    template <typename World, typename Keep>
+    void rebuild(const World& world, Keep keep) {
+        for (auto& batch : indices)
+            batch.clear();
+        for (size_t i = 0; i < world.size(); ++i)
+            if (world[i].alive && world[i].npc && keep(world[i]))
+                indices[type_slot(world[i].npc->type)].push_back(static_cast<uint32_t>(i));
+    }
+
+    template <typename T>
+    const std::vector<uint32_t>& of() const {
+        return indices[T::kType];
+    }
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "npc_registry.hpp"
+
+// Bit t set for NpcType t.
+using TypeMask = uint32_t;
+static_assert(kNpcSlots <= 32, "TypeMask has one bit per NpcType");
+
+// kHuntMask[t]: the types t can kill or be killed by.
+constexpr std::array<TypeMask, kNpcSlots> kHuntMask = [] {
+    std::array<TypeMask, kNpcSlots> table{};
+    for_each_kill_pair([&](auto attacker, auto prey) {
+        constexpr auto a = decltype(attacker)::type::kType;
+        constexpr auto p = decltype(prey)::type::kType;
+        table[a] |= TypeMask{1} << p;
+        table[p] |= TypeMask{1} << a;
+    });
+    return table;
+}();
+
+constexpr int kMaxKillDistance = [] {
+    size_t distance = 1;
+    for_each_npc_type([&](auto tag) {
+        distance = std::max(distance, decltype(tag)::type::kKillDistance);
+    });
+    return static_cast<int>(distance);
+}();
+
+// Coarse grid of square regions at least kMaxKillDistance wide, so two NPCs
+// close enough to fight are always in the same or neighbouring regions. A
+// region is active when one of its NPCs has a hunter or prey among the types
+// present in its 3x3 neighbourhood, and quiet otherwise: nothing in a quiet
+// region can be in a fight this tick.
+class RegionActivity {
+public:
+    void reset(int width, int height, int size = 0) {
+        side = std::max(size, kMaxKillDistance);
+        ncols = (width + side - 1) / side;
+        nrows = (height + side - 1) / side;
+        present.assign(static_cast<size_t>(ncols) * nrows, 0);
+        flags.assign(present.size(), 0);
+        active_total = 0;
+    }
+
+    template <typename World>
+    void classify(const World& world) {
+        std::fill(present.begin(), present.end(), 0);
+        for (const auto& state : world)
+            if (state.alive && state.npc)
+                present[region_of(state.npc->x, state.npc->y)] |=
+                    TypeMask{1} << type_slot(state.npc->type);
+
+        active_total = 0;
+        for (int ry = 0; ry < nrows; ++ry) {
+            for (int rx = 0; rx < ncols; ++rx) {
+                const size_t r = static_cast<size_t>(ry) * ncols + rx;
+                TypeMask hunt = 0;
+                for (size_t t = 0; t < kNpcSlots; ++t)
+                    if (present[r] & (TypeMask{1} << t))
+                        hunt |= kHuntMask[t];
+                TypeMask near = 0;
+                if (hunt) {
+                    for (int ny = std::max(ry - 1, 0); ny <= std::min(ry + 1, nrows - 1); ++ny)
+                        for (int nx = std::max(rx - 1, 0); nx <= std::min(rx + 1, ncols - 1); ++nx)
+                            near |= present[static_cast<size_t>(ny) * ncols + nx];
+                }
+                flags[r] = (hunt & near) != 0;
+                active_total += flags[r];
+            }
+        }
+    }
+
+    bool active(int x, int y) const { return flags[region_of(x, y)] != 0; }
+
+    size_t regions() const { return flags.size(); }
+    size_t active_regions() const { return active_total; }
+    int region_size() const { return side; }
+
+private:
+    size_t region_of(int x, int y) const {
+        const int rx = std::clamp(x / side, 0, ncols - 1);
+        const int ry = std::clamp(y / side, 0, nrows - 1);
+        return static_cast<size_t>(ry) * ncols + rx;
+    }
+
+    int side{kMaxKillDistance};
+    int ncols{0};
+    int nrows{0};
+    std::vector<TypeMask> present;
+    std::vector<uint8_t> flags;
+    size_t active_total{0};
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "factory.hpp"
+#include "npc_registry.hpp"
+#include "region_activity.hpp"
+
+constexpr double kTwoPi = 6.28318530717958647692;
+
+// One movement step: a random direction and a random fraction of the type's
+// step length (times `scale`), clamped to the map.
+template <typename Rng>
+void move_npc(NPC& npc, Rng& rng, int width, int height, double scale = 1.0) {
+    std::uniform_real_distribution<double> angle_dist(0.0, kTwoPi);
+    std::uniform_real_distribution<double> length_dist(0.0, 1.0);
+    const auto attr = get_attributes(npc.type);
+    double angle = angle_dist(rng);
+    double length = length_dist(rng) * attr.step * scale;
+    int dx = static_cast<int>(std::round(std::cos(angle) * length));
+    int dy = static_cast<int>(std::round(std::sin(angle) * length));
+    npc.x = std::clamp(npc.x + dx, 0, width - 1);
+    npc.y = std::clamp(npc.y + dy, 0, height - 1);
+}
+
+// Calls found(attacker_index, prey_index) for every Prey within
+// Attacker::kKillDistance of the attackers in batches.of<Attacker>()[begin, end).
+template <typename Attacker, typename Prey, typename World, typename Found>
+void scan_kill_pair(const World& world, const TypeBatches& batches,
+                    size_t begin, size_t end, Found found) {
+    const auto& attackers = batches.of<Attacker>();
+    const auto& prey = batches.of<Prey>();
+    for (size_t a = begin; a < end; ++a) {
+        const auto& attacker = world[attackers[a]].npc;
+        for (const uint32_t p : prey) {
+            if constexpr (std::is_same_v<Attacker, Prey>) {
+                if (p == attackers[a])
+                    continue;
+            }
+            if (attacker->is_close(world[p].npc, Attacker::kKillDistance))
+                found(attackers[a], p);
+        }
+    }
+}
+
+struct SimulationConfig {
+    int width{40};
+    int height{20};
+    size_t npcs{50};
+    std::vector<SpawnShare> shares{{DragonType, 1.0}, {PrincessType, 1.0}, {KnightType, 1.0}};
+    // 30 s of 200 ms movement ticks, as in the interactive run.
+    size_t ticks{150};
+    // Level of detail: NPCs in quiet regions (see RegionActivity) move only
+    // every quiet_interval ticks, sqrt(quiet_interval) times as far, and are
+    // left out of the pair scan. 1 updates every NPC every tick. Fights are
+    // never missed, but slower quiet NPCs meet attackers less often, so
+    // outcomes drift (more surviving dragons; see bench_lod).
+    size_t quiet_interval{1};
+    // Region side for the activity grid; raised to kMaxKillDistance.
+    int region_size{0};
+};
+
+struct KillEvent {
+    uint32_t tick;
+    NpcType attacker;
+    NpcType defender;
+};
+
+// A self-contained, seeded world stepped tick by tick. Nothing is shared
+// with other instances: no observers, no console, no log file, so many of
+// them can run side by side. Fights found in a tick are resolved in the same
+// tick with the same dice rule as the interactive run.
+class Simulation {
+public:
+    Simulation(const SimulationConfig& config, uint32_t seed)
+        : config(config), rng(seed) {
+        world.resize(config.npcs);
+        auto no_state = []() { return 0; };
+        auto emit = [&](int, size_t i, NpcType type, int x, int y) {
+            auto npc = make_npc(type, std::string(), x, y);
+            npc->id = i;
+            world[i].npc = std::move(npc);
+        };
+        if (!spawn_chunks(config.npcs, config.shares, config.width, config.height, seed, 1,
+                          no_state, emit))
+            world.clear();
+        if (adaptive()) {
+            regions.reset(config.width, config.height, config.region_size);
+            regions.classify(world);
+        }
+    }
+
+    void step() {
+        if (!adaptive()) {
+            for (auto& state : world)
+                if (state.alive)
+                    move_npc(*state.npc, rng, config.width, config.height);
+            batches.rebuild(world);
+        } else {
+            // Quiet NPCs take turns by index so each tick moves about the
+            // same number of them. Regions are reclassified after moving, so
+            // a fight is never missed; an NPC an attacker walked up to is
+            // back at the full rate from the next tick.
+            const double quiet_scale = std::sqrt(static_cast<double>(config.quiet_interval));
+            for (size_t i = 0; i < world.size(); ++i) {
+                auto& npc = *world[i].npc;
+                if (!world[i].alive)
+                    continue;
+                if (regions.active(npc.x, npc.y))
+                    move_npc(npc, rng, config.width, config.height);
+                else if ((tick + i) % config.quiet_interval == 0)
+                    move_npc(npc, rng, config.width, config.height, quiet_scale);
+                else
+                    ++skipped;
+            }
+            regions.classify(world);
+            batches.rebuild(world, [&](const NPCState& state) {
+                return regions.active(state.npc->x, state.npc->y);
+            });
+        }
+        candidates.clear();
+        for_each_kill_pair([&](auto attacker_tag, auto prey_tag) {
+            using Attacker = typename decltype(attacker_tag)::type;
+            using Prey = typename decltype(prey_tag)::type;
+            scan_kill_pair<Attacker, Prey>(world, batches, 0, batches.of<Attacker>().size(),
+                                           [&](uint32_t a, uint32_t p) {
+                                               candidates.emplace_back(a, p);
+                                           });
+        });
+
+        std::uniform_int_distribution<int> dice(1, 6);
+        for (const auto& [a, p] : candidates) {
+            if (!world[a].alive || !world[p].alive)
+                continue;
+            int attack = dice(rng);
+            int defense = dice(rng);
+            if (attack <= defense)
+                continue;
+            world[p].alive = false;
+            kill_log.push_back({static_cast<uint32_t>(tick), world[a].npc->type,
+                                world[p].npc->type});
+        }
+        ++tick;
+    }
+
+    void run() {
+        while (tick < config.ticks)
+            step();
+    }
+
+    size_t current_tick() const { return tick; }
+    const std::vector<NPCState>& npcs() const { return world; }
+    const std::vector<KillEvent>& kills() const { return kill_log; }
+    const RegionActivity& activity() const { return regions; }
+    // Movement updates skipped for NPCs in quiet regions so far.
+    size_t skipped_moves() const { return skipped; }
+
+    // Live NPCs per type, indexed by NpcType.
+    std::array<size_t, kNpcSlots> survivors() const {
+        std::array<size_t, kNpcSlots> counts{};
+        for (const auto& state : world)
+            if (state.alive)
+                ++counts[type_slot(state.npc->type)];
+        return counts;
+    }
+
+private:
+    bool adaptive() const { return config.quiet_interval > 1; }
+
+    SimulationConfig config;
+    std::mt19937 rng;
+    std::vector<NPCState> world;
+    TypeBatches batches;
+    RegionActivity regions;
+    std::vector<std::pair<uint32_t, uint32_t>> candidates;
+    std::vector<KillEvent> kill_log;
+    size_t tick{0};
+    size_t skipped{0};
+};
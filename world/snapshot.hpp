@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "factory.hpp"
+#include "npc_registry.hpp"
+
+// Fixed-size array published in whole versions. Snapshots share the front
+// (published) version, so taking one is a single reference count bump
+// whatever the size. The writer fills the back buffer with the next version
+// and publish() swaps it in, also O(1). The old front becomes the next back
+// buffer unless a snapshot still holds it; then prepare() allocates a fresh
+// one, which the writer should call before taking any lock.
+//
+// One writer at a time (callers hold world_mutex exclusively around the
+// writes and publish()). Snapshots may be read from any thread without locks.
+template <typename T>
+class VersionedBuffer {
+public:
+    using Version = std::vector<T>;
+
+    class Snapshot {
+    public:
+        Snapshot() = default;
+        size_t size() const { return version ? version->size() : 0; }
+        const T& operator[](size_t i) const { return (*version)[i]; }
+
+    private:
+        friend class VersionedBuffer;
+        explicit Snapshot(std::shared_ptr<const Version> version) : version(std::move(version)) {}
+
+        std::shared_ptr<const Version> version;
+    };
+
+    explicit VersionedBuffer(size_t count = 0)
+        : front(std::make_shared<Version>(count)), back(std::make_shared<Version>(count)) {}
+
+    size_t size() const { return front->size(); }
+    // The published version.
+    const T& operator[](size_t i) const { return (*front)[i]; }
+
+    void prepare() {
+        if (!back) {
+            back = std::make_shared<Version>(front->size());
+            ++allocated;
+        }
+    }
+
+    // Slot i of the next version. Every index must be written between
+    // prepare() and publish(); distinct indices may be written from several
+    // threads at once.
+    T& next(size_t i) { return (*back)[i]; }
+
+    void publish() {
+        std::shared_ptr<Version> previous = std::move(front);
+        front = std::move(back);
+        if (previous.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            back = std::move(previous);
+        }
+    }
+
+    Snapshot snapshot() const { return Snapshot(front); }
+
+    // Back buffers allocated because a snapshot still held the old front.
+    size_t allocations() const { return allocated; }
+
+private:
+    std::shared_ptr<Version> front;
+    std::shared_ptr<Version> back;
+    size_t allocated{0};
+};
+
+// What changes about an NPC during a run; type, name and id are fixed once
+// the world is built and are read from the NPC objects directly.
+struct PositionRecord {
+    int32_t x;
+    int32_t y;
+    bool alive;
+};
+
+using WorldPositions = VersionedBuffer<PositionRecord>;
+
+// Writes NPC i into the next version.
+inline void record_position(WorldPositions& positions, size_t i, const NPCState& state) {
+    positions.next(i) = {state.npc->x, state.npc->y, state.alive};
+}
+
+// Records the whole world as the next version and publishes it.
+inline void publish_positions(WorldPositions& positions, const std::vector<NPCState>& world) {
+    positions.prepare();
+    for (size_t i = 0; i < world.size(); ++i)
+        record_position(positions, i, world[i]);
+    positions.publish();
+}
+
+inline WorldPositions positions_of(const std::vector<NPCState>& world) {
+    WorldPositions positions(world.size());
+    publish_positions(positions, world);
+    return positions;
+}
+
+// Writes the live NPCs as of `snapshot` in the NPC::save format. The world
+// vector must not be resized while this runs; NPC positions are not read.
+inline void write_checkpoint(std::ostream& os, const std::vector<NPCState>& world,
+                             const WorldPositions::Snapshot& snapshot) {
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const auto& record = snapshot[i];
+        if (!record.alive)
+            continue;
+        const auto& npc = *world[i].npc;
+        os << npc.type << '\n' << npc.display_name() << '\n'
+           << record.x << '\n' << record.y << '\n';
+    }
+    os.flush();
+}
+
+inline std::vector<NPCState> load_checkpoint(std::istream& is) {
+    std::vector<NPCState> world;
+    int type = 0;
+    while (is >> type) {
+        std::shared_ptr<NPC> npc;
+        const bool known = dispatch_type(static_cast<NpcType>(type), [&](auto tag) {
+            npc = std::make_shared<typename decltype(tag)::type>(is);
+        });
+        if (!known || !is)
+            break;
+        world.push_back({std::move(npc), true});
+    }
+    return world;
+}
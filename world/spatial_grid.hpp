@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over a width x height map. rebuild() buckets points by cell
+// with a counting sort into one flat array, so a rectangle query touches
+// only the cells it overlaps and the points stored there.
+class SpatialGrid {
+public:
+    struct Entry {
+        uint32_t index;
+        int32_t x;
+        int32_t y;
+    };
+
+    SpatialGrid(int width, int height, int cell_size)
+        : cell(std::max(1, cell_size)),
+          ncols(std::max(1, (width + cell - 1) / cell)),
+          nrows(std::max(1, (height + cell - 1) / cell)),
+          cell_start(static_cast<size_t>(ncols) * nrows + 1, 0) {}
+
+    int cell_size() const { return cell; }
+    int columns() const { return ncols; }
+    int rows() const { return nrows; }
+
+    // `position(i, x, y)` fills in the position of point i and returns false
+    // for points that should be left out (dead NPCs). Points outside the map
+    // are clamped to the border cells.
+    template <typename Position>
+    void rebuild(size_t count, Position position) {
+        std::fill(cell_start.begin(), cell_start.end(), 0);
+        scratch.clear();
+        scratch.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            int x = 0;
+            int y = 0;
+            if (!position(i, x, y))
+                continue;
+            scratch.push_back({static_cast<uint32_t>(i), x, y});
+            ++cell_start[cell_of(x, y) + 1];
+        }
+        for (size_t c = 1; c < cell_start.size(); ++c)
+            cell_start[c] += cell_start[c - 1];
+
+        entries.resize(scratch.size());
+        std::vector<uint32_t> fill(cell_start.begin(), cell_start.end() - 1);
+        for (const auto& entry : scratch)
+            entries[fill[cell_of(entry.x, entry.y)]++] = entry;
+    }
+
+    // Calls fn(entry) for every point with x0 <= x <= x1 and y0 <= y <= y1.
+    template <typename Fn>
+    void query(int x0, int y0, int x1, int y1, Fn fn) const {
+        if (x1 < x0 || y1 < y0)
+            return;
+        const int c0 = clamp_col(x0);
+        const int c1 = clamp_col(x1);
+        const int r0 = clamp_row(y0);
+        const int r1 = clamp_row(y1);
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                const size_t id = static_cast<size_t>(r) * ncols + c;
+                for (uint32_t e = cell_start[id]; e < cell_start[id + 1]; ++e) {
+                    const auto& entry = entries[e];
+                    if (entry.x >= x0 && entry.x <= x1 && entry.y >= y0 && entry.y <= y1)
+                        fn(entry);
+                }
+            }
+        }
+    }
+
+    // Points bucketed in cell (c, r), unfiltered.
+    template <typename Fn>
+    void for_cell(int c, int r, Fn fn) const {
+        const size_t id = static_cast<size_t>(r) * ncols + c;
+        for (uint32_t e = cell_start[id]; e < cell_start[id + 1]; ++e)
+            fn(entries[e]);
+    }
+
+    size_t size() const { return entries.size(); }
+
+private:
+    int clamp_col(int x) const { return std::clamp(x / cell, 0, ncols - 1); }
+    int clamp_row(int y) const { return std::clamp(y / cell, 0, nrows - 1); }
+    size_t cell_of(int x, int y) const {
+        return static_cast<size_t>(clamp_row(y)) * ncols + clamp_col(x);
+    }
+
+    int cell;
+    int ncols;
+    int nrows;
+    std::vector<uint32_t> cell_start;
+    std::vector<Entry> entries;
+    std::vector<Entry> scratch;
+};
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "factory.hpp"
+#include "spatial_grid.hpp"
+
+// Area-of-interest streaming over a Unix domain socket.
+//
+// A viewer connects and sends a Viewport (it may send a new one at any
+// time). After every publish it receives one frame: a ViewFrameHeader
+// followed by `count` ViewDelta records describing what changed inside its
+// viewport since the previous frame. Records use host byte order; both ends
+// live on the same machine. NPC ids are indices into the world vector.
+
+struct Viewport {
+    int32_t x0;
+    int32_t y0;
+    int32_t x1;  // inclusive
+    int32_t y1;  // inclusive
+};
+
+enum ViewDeltaKind : uint8_t {
+    ViewEnter = 1,  // became visible: new NPC in the viewport
+    ViewMove = 2,   // still visible, new position
+    ViewLeave = 3,  // walked out of the viewport
+    ViewDeath = 4   // died while visible
+};
+
+struct ViewDelta {
+    uint32_t id;
+    uint8_t kind;
+    uint8_t type;
+    uint16_t reserved;
+    int32_t x;
+    int32_t y;
+};
+
+struct ViewFrameHeader {
+    uint32_t tick;
+    uint32_t count;
+};
+
+static_assert(sizeof(Viewport) == 16 && sizeof(ViewDelta) == 16 && sizeof(ViewFrameHeader) == 8,
+              "view protocol records must have no padding");
+
+class ViewServer {
+public:
+    // Frames a viewer has not read yet are buffered up to this size; a viewer
+    // that falls further behind is disconnected instead of stalling the run.
+    static constexpr size_t kMaxBacklog = 4 << 20;
+
+    ViewServer(int width, int height, int cell_size = 16) : grid(width, height, cell_size) {}
+
+    ~ViewServer() {
+        for (auto& viewer : viewers)
+            ::close(viewer.fd);
+        if (listen_fd >= 0) {
+            ::close(listen_fd);
+            ::unlink(path.c_str());
+        }
+    }
+
+    ViewServer(const ViewServer&) = delete;
+    ViewServer& operator=(const ViewServer&) = delete;
+
+    // Replaces a stale socket left at `socket_path`, but fails with EEXIST
+    // rather than delete anything else there.
+    bool listen(const std::string& socket_path) {
+        sockaddr_un addr{};
+        if (socket_path.size() >= sizeof(addr.sun_path))
+            return false;
+        struct stat existing{};
+        if (::lstat(socket_path.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                errno = EEXIST;
+                return false;
+            }
+            ::unlink(socket_path.c_str());
+        }
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0)
+            return false;
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+        if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(listen_fd, SOMAXCONN) < 0) {
+            ::close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        path = socket_path;
+        return true;
+    }
+
+    // Picks up new viewers and viewport changes; socket calls only, so call
+    // it before taking world_mutex.
+    void poll_viewers() {
+        accept_viewers();
+        for (auto& viewer : viewers)
+            if (viewer.fd >= 0)
+                read_requests(viewer);
+        prune();
+    }
+
+    // Queues one frame per viewer. Reads `world`, so the caller holds
+    // world_mutex (shared is enough); makes no system calls. Viewers only
+    // look at the grid cells under their viewport.
+    void collect(uint32_t tick, const std::vector<NPCState>& world) {
+        grid.rebuild(world.size(), [&](size_t i, int& x, int& y) {
+            const auto& state = world[i];
+            if (!state.alive || !state.npc)
+                return false;
+            x = state.npc->x;
+            y = state.npc->y;
+            return true;
+        });
+
+        for (auto& viewer : viewers) {
+            if (viewer.fd < 0 || !viewer.has_viewport)
+                continue;
+            queue_frame(viewer, tick, world);
+            if (viewer.outbox.size() - viewer.sent > kMaxBacklog)
+                drop(viewer);
+        }
+        prune();
+    }
+
+    // Writes queued frames without blocking; does not touch the world.
+    void flush() {
+        for (auto& viewer : viewers) {
+            while (viewer.fd >= 0 && viewer.sent < viewer.outbox.size()) {
+                const ssize_t n = ::send(viewer.fd, viewer.outbox.data() + viewer.sent,
+                                         viewer.outbox.size() - viewer.sent,
+                                         MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (n > 0) {
+                    viewer.sent += static_cast<size_t>(n);
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                        break;
+                    drop(viewer);
+                }
+            }
+            if (viewer.fd >= 0 && viewer.sent == viewer.outbox.size()) {
+                viewer.outbox.clear();
+                viewer.sent = 0;
+            }
+        }
+        prune();
+    }
+
+    void publish(uint32_t tick, const std::vector<NPCState>& world) {
+        poll_viewers();
+        collect(tick, world);
+        flush();
+    }
+
+    size_t viewer_count() const { return viewers.size(); }
+
+private:
+    struct Visible {
+        uint32_t id;
+        int32_t x;
+        int32_t y;
+    };
+
+    struct Viewer {
+        int fd{-1};
+        bool has_viewport{false};
+        Viewport viewport{};
+        std::vector<Visible> visible;  // sorted by id
+        std::vector<char> inbox;
+        std::vector<char> outbox;
+        size_t sent{0};
+    };
+
+    void accept_viewers() {
+        if (listen_fd < 0)
+            return;
+        for (;;) {
+            const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                break;
+            Viewer viewer;
+            viewer.fd = fd;
+            viewers.push_back(std::move(viewer));
+        }
+    }
+
+    void read_requests(Viewer& viewer) {
+        char buffer[256];
+        for (;;) {
+            const ssize_t n = ::recv(viewer.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n > 0) {
+                viewer.inbox.insert(viewer.inbox.end(), buffer, buffer + n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                drop(viewer);
+            break;
+        }
+        // Only the latest complete viewport matters.
+        const size_t complete = viewer.inbox.size() / sizeof(Viewport);
+        if (complete == 0)
+            return;
+        std::memcpy(&viewer.viewport, viewer.inbox.data() + (complete - 1) * sizeof(Viewport),
+                    sizeof(Viewport));
+        viewer.has_viewport = true;
+        viewer.inbox.erase(viewer.inbox.begin(),
+                           viewer.inbox.begin() + complete * sizeof(Viewport));
+    }
+
+    void queue_frame(Viewer& viewer, uint32_t tick, const std::vector<NPCState>& world) {
+        const auto& v = viewer.viewport;
+        current.clear();
+        grid.query(v.x0, v.y0, v.x1, v.y1, [&](const SpatialGrid::Entry& entry) {
+            current.push_back({entry.index, entry.x, entry.y});
+        });
+        std::sort(current.begin(), current.end(),
+                  [](const Visible& a, const Visible& b) { return a.id < b.id; });
+
+        deltas.clear();
+        auto record = [&](ViewDeltaKind kind, const Visible& npc) {
+            const auto type = static_cast<uint8_t>(world[npc.id].npc->type);
+            deltas.push_back({npc.id, kind, type, 0, npc.x, npc.y});
+        };
+        size_t i = 0;
+        size_t j = 0;
+        const auto& previous = viewer.visible;
+        while (i < previous.size() || j < current.size()) {
+            if (j == current.size() || (i < previous.size() && previous[i].id < current[j].id)) {
+                record(world[previous[i].id].alive ? ViewLeave : ViewDeath, previous[i]);
+                ++i;
+            } else if (i == previous.size() || current[j].id < previous[i].id) {
+                record(ViewEnter, current[j]);
+                ++j;
+            } else {
+                if (previous[i].x != current[j].x || previous[i].y != current[j].y)
+                    record(ViewMove, current[j]);
+                ++i;
+                ++j;
+            }
+        }
+        viewer.visible.swap(current);
+
+        const ViewFrameHeader header{tick, static_cast<uint32_t>(deltas.size())};
+        const auto* head = reinterpret_cast<const char*>(&header);
+        const auto* body = reinterpret_cast<const char*>(deltas.data());
+        viewer.outbox.insert(viewer.outbox.end(), head, head + sizeof(header));
+        viewer.outbox.insert(viewer.outbox.end(), body, body + deltas.size() * sizeof(ViewDelta));
+    }
+
+    void drop(Viewer& viewer) {
+        if (viewer.fd >= 0)
+            ::close(viewer.fd);
+        viewer.fd = -1;
+    }
+
+    void prune() {
+        viewers.erase(std::remove_if(viewers.begin(), viewers.end(),
+                                     [](const Viewer& viewer) { return viewer.fd < 0; }),
+                      viewers.end());
+    }
+
+    SpatialGrid grid;
+    int listen_fd{-1};
+    std::string path;
+    std::vector<Viewer> viewers;
+    std::vector<Visible> current;
+    std::vector<ViewDelta> deltas;
+};
+
+// Viewer side of the protocol; used by tests and local tools.
+class ViewClient {
+public:
+    ViewClient() = default;
+    ~ViewClient() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    ViewClient(const ViewClient&) = delete;
+    ViewClient& operator=(const ViewClient&) = delete;
+
+    bool connect(const std::string& socket_path) {
+        sockaddr_un addr{};
+        if (socket_path.size() >= sizeof(addr.sun_path))
+            return false;
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return false;
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+        return ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+
+    bool request(const Viewport& viewport) {
+        return write_all(reinterpret_cast<const char*>(&viewport), sizeof(viewport));
+    }
+
+    // Reads one frame and applies it to `visible`. Returns false on timeout
+    // or when the server went away.
+    bool receive(ViewFrameHeader& header, std::vector<ViewDelta>& deltas,
+                 int timeout_ms = 1000) {
+        if (!read_all(reinterpret_cast<char*>(&header), sizeof(header), timeout_ms))
+            return false;
+        deltas.resize(header.count);
+        if (!read_all(reinterpret_cast<char*>(deltas.data()),
+                      deltas.size() * sizeof(ViewDelta), timeout_ms))
+            return false;
+        for (const auto& delta : deltas) {
+            if (delta.kind == ViewEnter || delta.kind == ViewMove)
+                visible[delta.id] = delta;
+            else
+                visible.erase(delta.id);
+        }
+        return true;
+    }
+
+    // What the viewer currently sees, by NPC id.
+    std::map<uint32_t, ViewDelta> visible;
+
+private:
+    bool write_all(const char* data, size_t size) {
+        while (size > 0) {
+            const ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool read_all(char* data, size_t size, int timeout_ms) {
+        while (size > 0) {
+            pollfd pfd{fd, POLLIN, 0};
+            const int ready = ::poll(&pfd, 1, timeout_ms);
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready <= 0)
+                return false;
+            const ssize_t n = ::recv(fd, data, size, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    int fd{-1};
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Barrier for a fixed group of threads. Waiters spin for a short while,
+// since phases in a tick are usually short, and then park on the atomic
+// until the last thread arrives.
+class PhaseBarrier {
+public:
+    explicit PhaseBarrier(size_t parties, unsigned spin_limit = 4096)
+        : parties(parties), spin_limit(spin_limit) {}
+
+    void arrive_and_wait() {
+        const uint32_t current = generation.load(std::memory_order_acquire);
+        if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == parties) {
+            arrived.store(0, std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_acq_rel);
+            generation.notify_all();
+            return;
+        }
+        for (unsigned spin = 0; spin < spin_limit; ++spin) {
+            if (generation.load(std::memory_order_acquire) != current)
+                return;
+            if (spin % 64 == 63)
+                std::this_thread::yield();
+        }
+        while (generation.load(std::memory_order_acquire) == current)
+            generation.wait(current, std::memory_order_acquire);
+    }
+
+private:
+    const size_t parties;
+    const unsigned spin_limit;
+    std::atomic<size_t> arrived{0};
+    std::atomic<uint32_t> generation{0};
+};
+
+// Fixed set of threads that stay alive for the whole run. run() hands every
+// worker a slice of [0, count) and returns once all slices are done; the
+// calling thread works on slice 0, so a pool of one thread has no helpers.
+class WorkerPool {
+public:
+    using Job = std::function<void(size_t begin, size_t end, unsigned worker)>;
+
+    explicit WorkerPool(unsigned threads = 0)
+        : size(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+          start(size), done(size) {
+        for (unsigned w = 1; w < size; ++w)
+            helpers.emplace_back([this, w]() { loop(w); });
+    }
+
+    ~WorkerPool() {
+        stopping = true;
+        start.arrive_and_wait();
+        for (auto& helper : helpers)
+            helper.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    unsigned threads() const { return size; }
+
+    // Not reentrant: one run() at a time.
+    void run(size_t count, const Job& fn) {
+        if (size == 1) {
+            fn(0, count, 0);
+            return;
+        }
+        job = &fn;
+        total = count;
+        start.arrive_and_wait();
+        work(0);
+        done.arrive_and_wait();
+        job = nullptr;
+    }
+
+private:
+    void loop(unsigned worker) {
+        for (;;) {
+            start.arrive_and_wait();
+            if (stopping)
+                return;
+            work(worker);
+            done.arrive_and_wait();
+        }
+    }
+
+    void work(unsigned worker) {
+        const size_t chunk = (total + size - 1) / size;
+        const size_t begin = std::min(total, chunk * worker);
+        const size_t end = std::min(total, begin + chunk);
+        (*job)(begin, end, worker);
+    }
+
+    const unsigned size;
+    PhaseBarrier start;
+    PhaseBarrier done;
+    std::vector<std::thread> helpers;
+    const Job* job{nullptr};
+    size_t total{0};
+    bool stopping{false};
+};
+
+struct TickStats {
+    size_t ticks{0};
+    size_t overruns{0};  // ticks whose work ran past the next deadline
+    size_t skipped{0};   // whole periods dropped to get back on schedule
+    std::chrono::nanoseconds total_jitter{0};
+    std::chrono::nanoseconds max_jitter{0};
+
+    std::chrono::nanoseconds mean_jitter() const {
+        return ticks ? total_jitter / static_cast<long>(ticks) : std::chrono::nanoseconds{0};
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const TickStats& stats) {
+    using std::chrono::duration;
+    os << stats.ticks << " ticks, jitter mean "
+       << duration<double, std::micro>(stats.mean_jitter()).count() << " us, max "
+       << duration<double, std::micro>(stats.max_jitter).count() << " us, "
+       << stats.overruns << " overruns, " << stats.skipped << " skipped";
+    return os;
+}
+
+// Keeps a loop on a fixed grid of deadlines (start + k * period) rather than
+// sleeping a fixed time after the work, so ticks do not drift. After an
+// overrun the next tick starts at once; if a whole period was lost, the
+// missed deadlines are dropped instead of being replayed in a burst.
+// Jitter is how late each tick wakes up relative to its deadline.
+//
+// Clock is steady_clock outside tests. A test clock also provides a static
+// sleep_until(time_point), which the pacer calls instead of sleeping.
+template <typename Clock = std::chrono::steady_clock>
+class BasicTickPacer {
+public:
+    using clock = Clock;
+
+    explicit BasicTickPacer(typename clock::duration period,
+                            typename clock::time_point start = clock::now())
+        : period(period), deadline(start + period) {}
+
+    void wait() {
+        auto now = clock::now();
+        if (now < deadline) {
+            if constexpr (requires { clock::sleep_until(deadline); })
+                clock::sleep_until(deadline);
+            else
+                std::this_thread::sleep_until(deadline);
+            now = clock::now();
+        } else {
+            ++stats.overruns;
+        }
+        const auto late = std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline);
+        ++stats.ticks;
+        stats.total_jitter += late;
+        stats.max_jitter = std::max(stats.max_jitter, late);
+
+        deadline += period;
+        if (now >= deadline) {
+            const auto behind = (now - deadline) / period + 1;
+            stats.skipped += static_cast<size_t>(behind);
+            deadline += behind * period;
+        }
+    }
+
+    const TickStats& report() const { return stats; }
+
+private:
+    const typename clock::duration period;
+    typename clock::time_point deadline;
+    TickStats stats;
+};
+
+using TickPacer = BasicTickPacer<>;